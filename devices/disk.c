@@ -84,7 +84,7 @@ static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sector (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -228,7 +228,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sector (d, sec_no, 1);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
 	sema_down (&c->completion_wait);
 	if (!wait_while_busy (d))
@@ -252,7 +252,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 
 	c = d->channel;
 	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
+	select_sector (d, sec_no, 1);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy (d))
 		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
@@ -262,6 +262,71 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	lock_release (&c->lock);
 }
 
+/** #Clustered Swap SEC_NO부터 연속된 CNT개의 섹터를 하나의 READ SECTORS 명령으로 읽는다.
+   i번째 섹터는 BUFFERS[i]로 들어가므로 버퍼들이 연속일 필요는 없다.
+   명령 하나가 최대 DISK_MULTIPLE_MAX 섹터를 옮기므로 그보다 크면 나누어 보낸다. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffers[]) {
+	struct channel *c;
+
+	ASSERT (d != NULL);
+	ASSERT (buffers != NULL);
+
+	c = d->channel;
+	lock_acquire (&c->lock);
+	while (cnt > 0) {
+		size_t chunk = cnt < DISK_MULTIPLE_MAX ? cnt : DISK_MULTIPLE_MAX;
+
+		select_sector (d, sec_no, chunk);
+		issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+		/* 섹터 하나가 준비될 때마다 interrupt가 온다 */
+		for (size_t i = 0; i < chunk; i++) {
+			sema_down (&c->completion_wait);
+			if (!wait_while_busy (d))
+				PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + (disk_sector_t) i);
+			input_sector (c, buffers[i]);
+		}
+		d->read_cnt += chunk;
+		sec_no += chunk;
+		buffers += chunk;
+		cnt -= chunk;
+	}
+	lock_release (&c->lock);
+}
+
+/** #Clustered Swap BUFFERS[i]를 SEC_NO + i 섹터에 쓰되, 연속된 CNT개의 섹터를
+   하나의 WRITE SECTORS 명령으로 보낸다. 마지막 섹터를 디스크가 받은 뒤 돌아온다. */
+void
+disk_write_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+		void *buffers[]) {
+	struct channel *c;
+
+	ASSERT (d != NULL);
+	ASSERT (buffers != NULL);
+
+	c = d->channel;
+	lock_acquire (&c->lock);
+	while (cnt > 0) {
+		size_t chunk = cnt < DISK_MULTIPLE_MAX ? cnt : DISK_MULTIPLE_MAX;
+
+		select_sector (d, sec_no, chunk);
+		issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+		/* 섹터 하나를 받을 때마다 interrupt가 온다 */
+		for (size_t i = 0; i < chunk; i++) {
+			if (!wait_while_busy (d))
+				PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + (disk_sector_t) i);
+			output_sector (c, buffers[i]);
+			sema_down (&c->completion_wait);
+		}
+		d->write_cnt += chunk;
+		sec_no += chunk;
+		buffers += chunk;
+		cnt -= chunk;
+	}
+	lock_release (&c->lock);
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -414,17 +479,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO to the disk's sector selection registers and CNT
+   to its sector count register.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sector (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
-	ASSERT (sec_no < d->capacity);
-	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt >= 1 && cnt <= DISK_MULTIPLE_MAX);
+	ASSERT (sec_no + cnt <= d->capacity);
+	ASSERT (sec_no + cnt <= (1UL << 28));
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
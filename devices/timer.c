@@ -19,9 +19,30 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 입력 클럭 주파수 (Hz) */
+#define PIT_HZ 1193180
+
+/* tick 하나에 해당하는 8254 count */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* 8254 counter 0 모드 */
+#define PIT_MODE_ONESHOT  0 /* interrupt on terminal count */
+#define PIT_MODE_PERIODIC 2 /* rate generator */
+
+/** #Tickless Idle 한 번의 one-shot으로 미룰 수 있는 최대 tick 수 (16 bit counter).
+ *  100 Hz에서는 5 tick이므로 그보다 긴 idle 구간은 one-shot을 이어 붙여 채운다. */
+#define NOHZ_MAX_TICKS (UINT16_MAX / PIT_TICK_COUNT)
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/** #Tickless Idle */
+bool timer_tickless;          /* -tickless 옵션 */
+static int64_t nohz_ticks;    /* 진행 중인 one-shot이 끝나는 시점까지의 tick 수, 주기 모드면 0 */
+static uint16_t nohz_count;   /* 진행 중인 one-shot에 설정한 8254 count */
+static int64_t nohz_until;    /* idle 구간이 끝나는 tick, 이어 붙일 one-shot이 없으면 0 */
+static long long nohz_enters; /* # of one-shot idle periods. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -30,15 +51,16 @@ static intr_handler_func timer_interrupt;
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
+static void pit_program(int mode, uint16_t count);
+static uint16_t pit_read_count(void);
+static bool pit_out_high(void);
+static void nohz_arm(uint16_t remain);
 
 /* 초당 100 회 인터럽트하도록 8254 Programmable Interval Timer (PIT) 설정 및 인터럽트 등록 */
 void timer_init(void) {
     /* 8254 입력 주파수를 TIMER_FREQ로 나눠서 가장 가까운 값으로 반올림
        PC가 1초에 1193180 Hz의 클럭 신호를 발생시키기 때문에 1초에 100번 인터럽트를 발생시키게 하기 위한 값 */
-    uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;  //
-    outb(0x43, 0x34);                                          /* CW: counter 0(00), LSB then MSB(11), mode 2(010), binary(0). */
-    outb(0x40, count & 0xff);                                  // 하위 8 Bit 체크 ** 8bit bus로 연결되어 있음
-    outb(0x40, count >> 8);                                    // 상위 8 Bit 체크
+    pit_program(PIT_MODE_PERIODIC, PIT_TICK_COUNT);
 
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");  // 외부 인터럽트 핸들러를 호출하기 위한 VEC Number 등록
 }
@@ -112,10 +134,114 @@ void timer_nsleep(int64_t ns) {
 /* 타이머 상태 출력 */
 void timer_print_stats(void) {
     printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+    if (timer_tickless)
+        printf("Timer: %lld tickless idle periods\n", nohz_enters);
+}
+
+/** #Tickless Idle idle 쓰레드가 hlt 하기 직전에 호출. 주기적 tick 대신 DEADLINE tick
+ *  (MLFQS라면 다음 load_avg/recent_cpu 갱신 시점과 비교해 더 이른 쪽)까지 8254를
+ *  one-shot으로 설정한다. 한 번에 NOHZ_MAX_TICKS를 넘으면 timer_interrupt()가 다음
+ *  one-shot을 이어 붙인다. idle 쓰레드에는 time slice가 없으므로 time slice 만료는
+ *  고려하지 않는다. */
+void timer_nohz_enter(int64_t deadline) {
+    uint16_t remain;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (nohz_ticks > 0)
+        return;
+
+    if (thread_mlfqs) {
+        int64_t next_second = (ticks / TIMER_FREQ + 1) * TIMER_FREQ;
+        if (next_second < deadline)
+            deadline = next_second;
+    }
+
+    /* 다음 tick에 처리할 일이 있으면 주기 모드를 유지 */
+    if (deadline - ticks <= 1)
+        return;
+
+    /* 현재 tick 주기의 남은 count를 이어받아 tick 경계(phase)를 유지 */
+    remain = pit_read_count();
+    if (remain == 0 || remain > PIT_TICK_COUNT)
+        remain = PIT_TICK_COUNT;
+
+    nohz_until = deadline;
+    nohz_enters++;
+    nohz_arm(remain);
+}
+
+/** #Tickless Idle one-shot이 만료되기 전에 idle 쓰레드가 깨어나 다른 쓰레드로 전환될 때 호출.
+ *  지금까지 지난 tick 경계 수를 ticks에 반영하고, 다음 tick 경계까지 남은 count만큼
+ *  one-shot을 한 번 더 걸어 그 경계에서 주기 모드로 돌아가게 한다. 주기 모드로 바로
+ *  되돌리면 한 tick 미만의 나머지가 사라져 ticks가 실제 시간보다 조금씩 늦어진다. */
+void timer_nohz_exit(void) {
+    int64_t elapsed, left;
+    uint16_t count;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (nohz_ticks == 0)
+        return;
+
+    /* 더 이어 붙이지 않는다. 이미 만료되어 인터럽트가 대기 중이면 timer_interrupt()가 처리 */
+    nohz_until = 0;
+    if (pit_out_high())
+        return;
+
+    /* tick 경계는 count가 (nohz_ticks - 1) * PIT_TICK_COUNT, ..., PIT_TICK_COUNT, 0이 되는 지점 */
+    count = pit_read_count();
+    if (count == 0)
+        count = 1;
+    left = DIV_ROUND_UP(count, PIT_TICK_COUNT);
+    elapsed = nohz_ticks - left;
+    if (elapsed < 0)
+        elapsed = 0;
+
+    ticks += elapsed;
+    thread_tick_idle(elapsed);
+    nohz_ticks = 1;
+    nohz_count = count - (left - 1) * PIT_TICK_COUNT;
+    pit_program(PIT_MODE_ONESHOT, nohz_count);
+}
+
+/** #Tickless Idle 지금 tick 경계까지 REMAIN count가 남았을 때, nohz_until까지 중
+ *  NOHZ_MAX_TICKS 이하의 한 조각을 one-shot으로 설정 */
+static void nohz_arm(uint16_t remain) {
+    int64_t delta = nohz_until - ticks;
+
+    if (delta > NOHZ_MAX_TICKS)
+        delta = NOHZ_MAX_TICKS;
+
+    nohz_ticks = delta;
+    nohz_count = remain + (delta - 1) * PIT_TICK_COUNT;
+    pit_program(PIT_MODE_ONESHOT, nohz_count);
 }
 
 /* 타이머 인터럽트 핸들러 */
 static void timer_interrupt(struct intr_frame *args UNUSED) {
+    /** #Tickless Idle one-shot 만료 */
+    if (nohz_ticks > 0) {
+        /* mode 0의 counter는 0을 지나서도 계속 줄어드므로 만료 후 지난 count를 알 수 있다 */
+        uint16_t late = -pit_read_count();
+
+        /* idle 구간이 아직 남았으면 주기 모드로 돌아가지 않고 다음 조각을 이어 붙인다.
+           깨울 쓰레드도 MLFQS 갱신도 nohz_until 전에는 없다. */
+        if (ticks + nohz_ticks < nohz_until) {
+            ticks += nohz_ticks;
+            thread_tick_idle(nohz_ticks);
+            nohz_arm(late < PIT_TICK_COUNT ? PIT_TICK_COUNT - late : 1);
+            return;
+        }
+
+        /* 건너뛴 tick을 반영하고 주기 모드로 복귀 */
+        ticks += nohz_ticks - 1;
+        thread_tick_idle(nohz_ticks - 1);
+        nohz_ticks = 0;
+        nohz_until = 0;
+        pit_program(PIT_MODE_PERIODIC, PIT_TICK_COUNT);
+    }
+
     ticks++;
     thread_tick();
 
@@ -138,6 +264,29 @@ static void timer_interrupt(struct intr_frame *args UNUSED) {
         thread_awake(ticks);
 }
 
+/* 8254 counter 0을 MODE로 설정하고 COUNT를 적재 */
+static void pit_program(int mode, uint16_t count) {
+    outb(0x43, 0x30 | (mode << 1)); /* CW: counter 0(00), LSB then MSB(11), mode, binary(0). */
+    outb(0x40, count & 0xff);       // 하위 8 Bit 체크 ** 8bit bus로 연결되어 있음
+    outb(0x40, count >> 8);         // 상위 8 Bit 체크
+}
+
+/* 8254 counter 0의 현재 count를 latch하여 반환 */
+static uint16_t pit_read_count(void) {
+    uint8_t lo, hi;
+
+    outb(0x43, 0x00); /* CW: counter 0, counter latch command. */
+    lo = inb(0x40);
+    hi = inb(0x40);
+    return lo | (hi << 8);
+}
+
+/* 8254 counter 0의 OUT 핀이 high이면 (one-shot 만료) true 반환 */
+static bool pit_out_high(void) {
+    outb(0x43, 0xe2); /* CW: read-back, latch status only, counter 0. */
+    return (inb(0x40) & 0x80) != 0;
+}
+
 /* loop가 1개 초과시 true 반환 */
 static bool too_many_loops(unsigned loops) {
     /* Wait for a timer tick. */
@@ -2,11 +2,16 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/** #Tickless Idle idle 중 주기적 tick을 멈출지 여부.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init(void);
 void timer_calibrate(void);
 
@@ -20,4 +25,8 @@ void timer_nsleep(int64_t nanoseconds);
 
 void timer_print_stats(void);
 
+/** #Tickless Idle 함수 */
+void timer_nohz_enter(int64_t deadline);
+void timer_nohz_exit(void);
+
 #endif /* devices/timer.h */
@@ -97,11 +97,4 @@ uint64_t hash_bytes (const void *, size_t);
 uint64_t hash_string (const char *);
 uint64_t hash_int (int);
 
-/* hash_init */
-uint64_t hash_func(const struct hash_elem *e, void *aux);
-bool less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux);
-
-/* hash_destructor */
-void hash_destructor(struct hash_elem *e, void *aux);
-
 #endif /* lib/kernel/hash.h */
@@ -0,0 +1,67 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Pairing heap.
+ *
+ * A priority queue that, like our lists and hash tables, does
+ * not require dynamic allocation.  Each structure that can be in
+ * a heap must embed a struct heap_elem member, and the heap_entry
+ * macro converts a struct heap_elem back to the structure object
+ * that contains it.  Refer to lib/kernel/list.h for a detailed
+ * explanation of the technique.
+ *
+ * The element that compares least under the heap's less function
+ * sits at the root.  heap_insert() is O(1); heap_pop_min() and
+ * heap_remove() run in O(log n) amortized time.  Nothing here
+ * recurses, so it is safe to use on the small kernel stacks and
+ * from interrupt handlers (with interrupts disabled). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* Leftmost child. */
+	struct heap_elem *next;     /* Right sibling. */
+	struct heap_elem *prev;     /* Left sibling, or parent if leftmost. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Least element, or NULL if empty. */
+	size_t elem_cnt;            /* Number of elements in heap. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop_min (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+
+/* Heap elements. */
+struct heap_elem *heap_min (struct heap *);
+
+/* Heap properties. */
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
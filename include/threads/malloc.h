@@ -4,10 +4,23 @@
 #include <debug.h>
 #include <stddef.h>
 
+/** #Malloc Magazine size class(descriptor) 수와 magazine 하나에 담는 최대 block 수 */
+#define MAGAZINE_CLASS_CNT 7
+#define MAGAZINE_SIZE 16
+
+/** #Malloc Magazine 쓰레드가 lock 없이 쓰는 size class별 free block 스택.
+   block끼리 block의 첫 word로 연결된다. */
+struct magazine {
+	void *top;                  /* 가장 최근에 넣은 block */
+	unsigned cnt;               /* 들어 있는 block 수 */
+};
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+size_t malloc_block_size (void *);
+void malloc_drain (void);
 
 #endif /* threads/malloc.h */
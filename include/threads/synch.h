@@ -1,13 +1,14 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority first. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,6 +21,10 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+	/** #Priority Donation */
+	int priority;               /* 이 lock을 통해 holder에게 기부된 가장 높은 priority */
+	struct heap_elem held_elem; /* holder의 held_locks 원소 */
 };
 
 void lock_init (struct lock *);
@@ -38,9 +43,35 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
-/** #Priority Scheduling - Synchronization 함수 */
+/** #Reader-Writer Lock struct thread 안에 미리 두는 read 보유 기록 수.
+   이보다 많은 rwlock을 동시에 read로 보유하면 나머지 기록은 malloc()한다. */
+#define RWLOCK_READ_INLINE 4
+
+/** #Reader-Writer Lock 쓰레드가 read로 보유 중인 rwlock 기록 */
+struct rwlock_hold {
+	struct list_elem elem;        /* rwlock의 readers 리스트 원소 */
+	struct list_elem thread_elem; /* 쓰레드의 read_holds 리스트 원소 */
+	struct rwlock *rwlock;        /* 보유 중인 rwlock, 빈 칸이면 NULL */
+	struct thread *thread;        /* 보유 쓰레드 */
+};
+
+/** #Reader-Writer Lock. 여러 reader가 동시에 보유하거나 writer 하나가 보유한다.
+   writer는 기다리는 동안에도 write_lock을 잡고 있어 새 reader를 막으므로 writer가
+   굶지 않는다(writer preference). 막힌 reader와 writer는 write_lock을 통해 writer에게,
+   reader가 나가기를 기다리는 writer는 모든 reader에게 priority를 기부한다. */
+struct rwlock {
+	struct lock write_lock;          /* writer가 보유 (대기 중인 writer 포함) */
+	struct list readers;             /* struct rwlock_hold 리스트 */
+	struct thread *pending_writer;   /* reader가 모두 나가기를 기다리는 writer */
+	struct semaphore readers_done;   /* 마지막 reader가 pending_writer를 깨운다 */
+};
 
-bool cmp_sem_priority(const struct list_elem *, const struct list_elem *, void *);
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
 
 /* Optimization barrier.
  *
@@ -2,10 +2,12 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
 
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #ifdef VM
 #include "vm/vm.h"
@@ -106,18 +108,33 @@ typedef struct thread {
     struct list_elem elem; /* List element. */
 
     /** #Project 1: Alarm Clock */
-    int64_t wakeup_tick; /* 활성화 틱 */
+    int64_t wakeup_tick;         /* 활성화 틱 */
+    struct heap_elem sleep_elem; /* sleep_heap 원소 */
 
     /** #Project 1: Priority Donation */
     int original_priority;          /* 기존 Priority */
     struct lock *wait_lock;         /* 대기중인 lock */
-    struct list donations;          /* Donation List. */
-    struct list_elem donation_elem; /* Donation Element. */
+    struct heap held_locks;         /* 보유 중인 lock, 기부된 priority가 높은 순 */
+
+    /** #Project 1: Priority Scheduling - Synchronization */
+    struct semaphore *blocked_sema; /* 대기중인 semaphore */
+    struct heap_elem wait_elem;     /* semaphore waiters 원소 */
+    uint64_t wait_seq;              /* 같은 priority 사이의 대기 순서 */
+
+    /** #Reader-Writer Lock */
+    struct rwlock_hold read_hold_slots[RWLOCK_READ_INLINE]; /* 미리 둔 read 보유 기록 */
+    struct list read_holds;                 /* read로 보유 중인 rwlock의 struct rwlock_hold */
+    struct rwlock *wait_rwlock;             /* reader가 나가기를 기다리는 rwlock */
+
+    /** #Malloc Magazine size class별 free block 캐시 */
+    struct magazine magazines[MAGAZINE_CLASS_CNT];
 
     /** #Project 1: Advanced Scheduler */
     int niceness;              /* Niceness. */
     int recent_cpu;            /* 최근 CPU 점유 시간 */
-    struct list_elem all_elem; /* 살아있는 모든 Thread 연결 */
+    int64_t recent_cpu_epoch;  /* recent_cpu에 반영된 decay 횟수 */
+    struct list_elem decay_elem; /* BLOCKED 동안 decay_waiters의 원소 */
+    bool decay_waiting;          /* decay_waiters에 들어 있으면 true */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -146,6 +163,10 @@ typedef struct thread {
     /** Project 3: Anonymous Page - stack용 포인터 생성*/
     void *stack_bottom;
     void *stack_pointer;
+
+    /** #Fault Around 직전 fault-around가 채운 범위의 바로 다음 주소와 현재 창 크기(페이지) */
+    void *fault_around_next;
+    size_t fault_around_window;
 #endif
 
     /** Project 4: Filesys - File System */
@@ -173,7 +194,6 @@ bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *au
 
 /** #Project 1: Priority Donation 함수  */
 void donate_priority(void);
-void remove_with_lock(struct lock *lock);
 void refresh_priority(void);
 
 /** #Project 1: Advance Scheduler 함수 */
@@ -183,11 +203,13 @@ void mlfqs_load_avg(void);
 void mlfqs_increment(void);
 void mlfqs_recalc_recent_cpu(void);
 void mlfqs_recalc_priority(void);
+void mlfqs_update_waiters(struct heap *waiters);
 
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_tick_idle(int64_t ticks);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
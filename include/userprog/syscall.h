@@ -20,7 +20,7 @@ typedef int pid_t;
 void check_address(void *addr);
 #else
 /** #Project 3: Anonymous Page */
-struct page *check_address(void *addr);
+bool check_address(void *addr);
 #endif
 
 void halt(void);
@@ -49,7 +49,7 @@ bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 
 /** #Project 2: System Call */
-extern struct lock filesys_lock;  // 파일 읽기/쓰기 용 lock
+extern struct rwlock filesys_lock;  // 파일 읽기/쓰기 용 lock (read()만 read로 보유)
 
 /** #Project 2: Extend File Descriptor (Extra) */
 int dup2(int oldfd, int newfd);
@@ -2,17 +2,31 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 #include "threads/vaddr.h"
+#include "filesys/off_t.h"
 
 struct page;
+struct inode;
 enum vm_type;
 
 #define SLOT_SIZE (PGSIZE / DISK_SECTOR_SIZE)
+/** #Clustered Swap 한 번의 디스크 명령으로 swap in/out하는 최대 페이지 수 */
+#define SWAP_CLUSTER 8
 
 struct anon_page {
     size_t slot;
+    struct zswap_entry *zswap;  /** #Compressed Swap 압축 캐시에 있으면 그 entry */
+
+    /** #Shared Text 실행 파일에서 읽은 읽기 전용 페이지면 그 위치. 내보낼 때 쓰지 않고 버리고
+     *  다시 fault가 나면 여기서 읽는다. 아니면 text_inode가 NULL */
+    struct inode *text_inode;
+    off_t text_ofs;
+    size_t text_bytes;
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_copy (struct page *page, void *kva);
+bool anon_swap_out_cluster (struct page *pages[], size_t cnt);
+bool anon_swap_write (struct page *page, void *kva);
 
 #endif
@@ -31,6 +31,7 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -41,6 +42,11 @@ struct thread;
 #define VM_TYPE(type) ((type) & 7)
 #define STACK_LIMIT (USER_STACK - (1 << 20)) // 1MB 제한
 
+/** #Fault Around 파일에서 읽는 페이지에 fault가 나면 이어지는 페이지들까지 최대 이만큼 함께 채운다 */
+#define FAULT_AROUND_MIN 2
+#define FAULT_AROUND_DEFAULT 16
+extern size_t fault_around_pages;
+
 /* The representation of "page".
  * This is kind of "parent class", which has four "child class"es, which are
  * uninit_page, file_page, anon_page, and page cache (project4).
@@ -51,9 +57,12 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
-	struct hash_elem hash_elem ;
 	bool writable;
 	bool accessible;
+
+	/** Project 3: Copy On Write (Extra) */
+	struct thread *owner;          /* 이 페이지를 가진 프로세스 */
+	struct list_elem share_elem;   /* frame->pages 원소 */
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
 	union {
@@ -67,11 +76,27 @@ struct page {
 };
 
 /* The representation of "frame" */
+/** #Frame Table user pool의 물리 frame마다 하나씩 vm_init()에서 미리 만들어 두고
+ *  (kva - user pool 시작) / PGSIZE 번째 원소로 찾는다. */
 struct frame {
 	void *kva;
 	struct page *page;
 
-	struct list_elem frame_elem;
+	bool used;                     /* 사용자 페이지에 쓰이고 있으면 true */
+
+	/** Project 3: Copy On Write (Extra) fork 후 이 frame을 읽기 전용으로 공유하는 페이지들.
+	 *  page는 그 중 하나(대표)를 가리킨다. */
+	struct list pages;
+	int ref_cnt;
+
+	/** Project 3: Page Reclaim 내용을 채우는 중이라 내보내면 안 되는 frame */
+	bool pinned;
+
+	/** #Shared Text 읽기 전용 실행 파일 페이지 캐시에 있으면 그 key. 없으면 text_inode가 NULL */
+	struct hash_elem text_elem;
+	struct inode *text_inode;
+	off_t text_ofs;
+	size_t text_bytes;
 };
 
 /* The function table for page operations.
@@ -93,8 +118,11 @@ struct page_operations {
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
+/** #VMA 주소 공간은 VMA로 기록하고, 페이지 객체는 처음 찾을 때 만들어 radix 트리에 둔다 */
 struct supplemental_page_table {
-	struct hash spt_hash;
+	struct vma_tree vmas;       /* 구간들 */
+	struct page_index pages;    /* 만들어진 페이지 객체들 */
+	struct thread *owner;
 };
 
 #include "threads/thread.h"
@@ -104,10 +132,14 @@ bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
+struct page *spt_get_page (struct supplemental_page_table *spt, void *va);
+bool spt_is_mapped (struct supplemental_page_table *spt, void *va,
+		bool writable);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -116,7 +148,17 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+bool vm_map_range (void *addr, size_t length, enum vm_type type, bool writable,
+		struct file *file, off_t offset, size_t read_bytes);
+void vm_unmap_range (void *addr);
 bool vm_claim_page (void *va);
+void vm_frame_unlink (struct page *page);
+bool vm_frame_unmap (struct frame *frame);
+void vm_frame_detach (struct frame *frame);
+void vm_frame_remove (struct frame *frame);
+void vm_frame_table_acquire (void);
+void vm_frame_table_release (void);
+struct frame *vm_frame_prefetch (struct page *page);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
@@ -0,0 +1,59 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct page;
+struct file;
+
+/** #VMA 프로세스 가상 주소 공간의 한 구간 [start, end).
+ *  내용이 어디서 오는지만 기록하고, 페이지 객체는 그 페이지에 처음 접근할 때 만든다. */
+struct vma {
+	void *start;            /* 첫 페이지 주소 */
+	void *end;              /* 마지막 페이지 다음 주소 */
+	int type;               /* 페이지 타입 (enum vm_type) */
+	bool writable;
+	struct file *file;      /* 내용을 읽어 올 파일. VMA가 닫는다. NULL이면 0으로 채움 */
+	off_t offset;           /* start에 대응하는 파일 위치 */
+	size_t read_bytes;      /* start부터 파일에서 읽을 바이트 수. 나머지는 0으로 채운다 */
+
+	struct vma *left;       /* AVL 트리 */
+	struct vma *right;
+	int height;
+};
+
+/** #VMA start 순으로 정렬된 AVL 트리 */
+struct vma_tree {
+	struct vma *root;
+};
+
+void vma_tree_init (struct vma_tree *);
+void vma_insert (struct vma_tree *, struct vma *);
+void vma_remove (struct vma_tree *, struct vma *);
+struct vma *vma_find (struct vma_tree *, const void *va);
+bool vma_overlaps (struct vma_tree *, const void *start, const void *end);
+void vma_foreach (struct vma_tree *, void (*action) (struct vma *, void *aux),
+		void *aux);
+
+/** #VMA 가상 페이지 번호로 만들어진 페이지 객체를 찾는 radix 트리.
+ *  노드 하나가 PAGE_INDEX_BITS 비트를 나누며, 페이지가 있는 경로의 노드만 만들고
+ *  마지막 자식이 빠지면 해제한다. 스택은 USER_STACK 아래에 있지만 mmap은 KERN_BASE 아래
+ *  어디든 올 수 있으므로, pg_no(KERN_BASE - 1)까지의 28비트를 덮는다.
+ *  노드 하나(128 * 8 byte)가 malloc()의 1 kB block 하나에 딱 맞는다. */
+#define PAGE_INDEX_BITS 7
+#define PAGE_INDEX_LEVELS 4     /* 4 * 7 = 28비트 >= user 가상 페이지 번호 */
+
+struct page_index {
+	void **root;
+};
+
+void page_index_init (struct page_index *);
+struct page *page_index_lookup (struct page_index *, const void *va);
+bool page_index_insert (struct page_index *, struct page *);
+void page_index_remove (struct page_index *, const void *va);
+void page_index_foreach (struct page_index *, const void *start,
+		const void *end, void (*action) (struct page *, void *aux), void *aux);
+void page_index_destroy (struct page_index *);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+/** #Compressed Swap entry 머리를 포함해 이 크기 이하로 압축되는 페이지만 캐시에 넣는다.
+ *  malloc()의 size class 하나와 같아야 낭비가 없다. 나머지는 swap disk로 간다 */
+#define ZSWAP_MAX_LEN 1024
+
+void zswap_init (void);
+bool zswap_store (struct page *page, const void *kva);
+bool zswap_load (struct page *page, void *kva);
+bool zswap_copy (struct page *page, void *kva);
+void zswap_invalidate (struct page *page);
+void zswap_print_stats (void);
+
+#endif
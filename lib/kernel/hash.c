@@ -8,7 +8,6 @@
 #include "hash.h"
 #include "../debug.h"
 #include "threads/malloc.h"
-#include "vm/vm.h"
 
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
 	list_entry(LIST_ELEM, struct hash_elem, list_elem)
@@ -397,22 +396,3 @@ remove_elem (struct hash *h, struct hash_elem *e) {
 	h->elem_cnt--;
 	list_remove (&e->list_elem);
 }
-
-/* hash_init -> hash_funct, less_func */
-uint64_t hash_func(const struct hash_elem *e, void *aux) {
-    const struct page *p = hash_entry(e, struct page, hash_elem);
-    return hash_bytes(&p->va, sizeof(p->va));
-}
-
-bool less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux) {
-    const struct page *pa = hash_entry(a, struct page, hash_elem);
-    const struct page *pb = hash_entry(b, struct page, hash_elem);
-
-    return pa->va < pb->va;
-}
-
-void hash_destructor(struct hash_elem *e, void *aux) {
-    const struct page *p = hash_entry(e, struct page, hash_elem); // hash_elem을 포함하고 있는 페이지를 반환해주는 함수.
-    destroy(p);
-    free(p);
-}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "heap.h"
+
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Each node
+   keeps a pointer to its leftmost child, and the children of a
+   node form a doubly linked sibling list through `next' and
+   `prev'.  The leftmost child's `prev' points back to the parent
+   instead, which lets heap_remove() unlink any node in O(1).
+
+   Two trees are combined by "melding": the root that compares
+   greater becomes the new leftmost child of the other.  Removing
+   a root leaves a list of subtrees that is melded back together
+   in two passes, first pairwise from left to right, then from
+   right to left.  This two-pass pairing is what gives the
+   O(log n) amortized bound. */
+
+static struct heap_elem *meld(struct heap *, struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs(struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void heap_init(struct heap *heap, heap_less_func *less, void *aux) {
+    ASSERT(heap != NULL);
+    ASSERT(less != NULL);
+
+    heap->root = NULL;
+    heap->elem_cnt = 0;
+    heap->less = less;
+    heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void heap_insert(struct heap *heap, struct heap_elem *elem) {
+    ASSERT(heap != NULL);
+    ASSERT(elem != NULL);
+
+    elem->child = elem->next = elem->prev = NULL;
+    heap->root = meld(heap, heap->root, elem);
+    heap->elem_cnt++;
+}
+
+/* Returns the least element in HEAP.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *heap_min(struct heap *heap) {
+    ASSERT(!heap_empty(heap));
+    return heap->root;
+}
+
+/* Removes the least element from HEAP and returns it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *heap_pop_min(struct heap *heap) {
+    struct heap_elem *min = heap_min(heap);
+
+    heap->root = merge_pairs(heap, min->child);
+    heap->elem_cnt--;
+
+    min->child = NULL;
+    return min;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void heap_remove(struct heap *heap, struct heap_elem *elem) {
+    ASSERT(heap != NULL);
+    ASSERT(elem != NULL);
+
+    if (elem == heap->root) {
+        heap_pop_min(heap);
+        return;
+    }
+
+    /* Unlink ELEM, together with its subtree, from its siblings. */
+    ASSERT(elem->prev != NULL);
+    if (elem->prev->child == elem)
+        elem->prev->child = elem->next;
+    else
+        elem->prev->next = elem->next;
+    if (elem->next != NULL)
+        elem->next->prev = elem->prev;
+
+    /* Meld ELEM's children back into the heap. */
+    heap->root = meld(heap, heap->root, merge_pairs(heap, elem->child));
+    heap->elem_cnt--;
+
+    elem->child = elem->next = elem->prev = NULL;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t heap_size(struct heap *heap) {
+    ASSERT(heap != NULL);
+    return heap->elem_cnt;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool heap_empty(struct heap *heap) {
+    ASSERT(heap != NULL);
+    return heap->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  The returned root
+   has no siblings. */
+static struct heap_elem *meld(struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+    struct heap_elem *tmp;
+
+    if (a == NULL)
+        return b;
+    if (b == NULL)
+        return a;
+
+    if (heap->less(b, a, heap->aux)) {
+        tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    /* B becomes A's leftmost child. */
+    b->prev = a;
+    b->next = a->child;
+    if (a->child != NULL)
+        a->child->prev = b;
+    a->child = b;
+
+    a->next = a->prev = NULL;
+    return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree
+   and returns its root, or a null pointer if FIRST is null. */
+static struct heap_elem *merge_pairs(struct heap *heap, struct heap_elem *first) {
+    struct heap_elem *stack = NULL;
+    struct heap_elem *root = NULL;
+
+    /* First pass: meld siblings pairwise from left to right,
+       pushing each result onto STACK through its `next' link. */
+    while (first != NULL) {
+        struct heap_elem *a = first;
+        struct heap_elem *b = a->next;
+        struct heap_elem *pair;
+
+        first = b != NULL ? b->next : NULL;
+        a->next = a->prev = NULL;
+        if (b != NULL)
+            b->next = b->prev = NULL;
+
+        pair = meld(heap, a, b);
+        pair->next = stack;
+        stack = pair;
+    }
+
+    /* Second pass: meld the pairs from right to left. */
+    while (stack != NULL) {
+        struct heap_elem *pair = stack;
+
+        stack = pair->next;
+        pair->next = NULL;
+        root = meld(heap, root, pair);
+    }
+
+    return root;
+}
@@ -0,0 +1,86 @@
+/* Exercises the pairing heap that keeps sleeping threads
+   ordered by wakeup tick.  Inserts elements with scrambled keys
+   (including duplicates), removes a third of them from the
+   middle of the heap, and checks that the rest come out in
+   nondecreasing key order with nothing lost or duplicated. */
+
+#include <heap.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+
+#define ELEM_CNT 500
+
+struct item
+  {
+    struct heap_elem elem;
+    int key;
+    bool removed;
+    bool popped;
+  };
+
+static struct item items[ELEM_CNT];
+
+static bool
+item_less (const struct heap_elem *a_, const struct heap_elem *b_,
+           void *aux UNUSED)
+{
+  const struct item *a = heap_entry (a_, struct item, elem);
+  const struct item *b = heap_entry (b_, struct item, elem);
+
+  return a->key < b->key;
+}
+
+void
+test_alarm_heap (void)
+{
+  struct heap heap;
+  unsigned seed = 12345;
+  size_t remain = ELEM_CNT;
+  int prev_key = -1;
+  int i;
+
+  heap_init (&heap, item_less, NULL);
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      /* Small key range so that many keys repeat. */
+      seed = seed * 1103515245 + 12345;
+      items[i].key = (seed >> 16) % 200;
+      items[i].removed = items[i].popped = false;
+      heap_insert (&heap, &items[i].elem);
+    }
+  if (heap_size (&heap) != ELEM_CNT)
+    fail ("heap has %zu elements after inserting %d",
+          heap_size (&heap), ELEM_CNT);
+
+  /* Remove every third element, wherever it sits in the heap. */
+  for (i = 0; i < ELEM_CNT; i += 3)
+    {
+      heap_remove (&heap, &items[i].elem);
+      items[i].removed = true;
+      remain--;
+    }
+  if (heap_size (&heap) != remain)
+    fail ("heap has %zu elements after removals, expected %zu",
+          heap_size (&heap), remain);
+
+  while (!heap_empty (&heap))
+    {
+      struct item *it = heap_entry (heap_pop_min (&heap), struct item, elem);
+
+      if (it->removed || it->popped)
+        fail ("element %d came out of the heap twice", (int) (it - items));
+      if (it->key < prev_key)
+        fail ("key %d popped after key %d", it->key, prev_key);
+      it->popped = true;
+      prev_key = it->key;
+      remain--;
+    }
+  if (remain != 0)
+    fail ("%zu elements missing from the heap", remain);
+
+  for (i = 0; i < ELEM_CNT; i++)
+    if (!items[i].removed && !items[i].popped)
+      fail ("element %d never came out of the heap", i);
+
+  pass ();
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-heap) begin
+(alarm-heap) PASS
+(alarm-heap) end
+EOF
+pass;
@@ -0,0 +1,100 @@
+/* Checks that tickless idle keeps the tick count in step with
+   real time.  Must be run with -tickless.
+
+   First a few threads sleep for much longer than one 8254
+   one-shot can cover, so the idle thread has to chain one-shots
+   up to each wakeup; every sleeper must wake exactly on its
+   tick.  Then the test stands in for the idle thread: it enters
+   a one-shot idle period and leaves it again half way through a
+   tick, DRIFT_ROUNDS times, busy-waiting a known real time in
+   between.  The ticks counted over all rounds must match that
+   real time, so timer_nohz_exit() may neither drop nor invent
+   the partial tick it leaves in. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 3
+#define DRIFT_ROUNDS 40
+#define HALF_TICKS_PER_ROUND 5
+
+struct sleeper
+  {
+    int64_t start;              /* Tick when the sleep began. */
+    int duration;               /* Ticks to sleep. */
+    int64_t slept;              /* Ticks actually slept. */
+    struct semaphore done;      /* Upped after waking. */
+  };
+
+static void
+sleeper (void *s_)
+{
+  struct sleeper *s = s_;
+
+  timer_sleep (s->duration);
+  s->slept = timer_elapsed (s->start);
+  sema_up (&s->done);
+}
+
+void
+test_alarm_tickless (void)
+{
+  static const int durations[SLEEPER_CNT] = {23, 61, 137};
+  struct sleeper sleepers[SLEEPER_CNT];
+  int64_t start, counted, expected;
+  int i, j;
+
+  /* This test does not work with the MLFQS, and needs -tickless. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (timer_tickless);
+
+  /* Long sleeps, chained one-shots. */
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      struct sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->duration = durations[i];
+      sema_init (&s->done, 0);
+      snprintf (name, sizeof name, "sleeper %d", i);
+      s->start = timer_ticks ();
+      thread_create (name, PRI_DEFAULT, sleeper, s);
+    }
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      struct sleeper *s = &sleepers[i];
+
+      sema_down (&s->done);
+      if (s->slept < s->duration || s->slept > s->duration + 1)
+        fail ("sleeper %d slept %lld ticks, expected %d",
+              i, s->slept, s->duration);
+    }
+  msg ("Sleepers woke on their ticks.");
+
+  /* Leave DRIFT_ROUNDS idle periods half way through a tick. */
+  timer_sleep (1);
+  start = timer_ticks ();
+  for (i = 0; i < DRIFT_ROUNDS; i++)
+    {
+      enum intr_level old_level = intr_disable ();
+      timer_nohz_enter (timer_ticks () + 20);
+      intr_set_level (old_level);
+
+      for (j = 0; j < HALF_TICKS_PER_ROUND; j++)
+        timer_usleep (1000 * 1000 / TIMER_FREQ / 2);
+
+      old_level = intr_disable ();
+      timer_nohz_exit ();
+      intr_set_level (old_level);
+    }
+  counted = timer_elapsed (start);
+  expected = DRIFT_ROUNDS * HALF_TICKS_PER_ROUND / 2;
+  if (counted < expected - expected / 20 || counted > expected + expected / 20)
+    fail ("%lld ticks counted over %lld ticks of real time",
+          counted, expected);
+  msg ("Tick count kept up with real time.");
+}
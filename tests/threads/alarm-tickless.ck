@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) Sleepers woke on their ticks.
+(alarm-tickless) Tick count kept up with real time.
+(alarm-tickless) end
+EOF
+pass;
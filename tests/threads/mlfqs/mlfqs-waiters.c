@@ -0,0 +1,84 @@
+/* Checks that a semaphore wakes the waiter with the highest
+   priority as of the wake-up, not as of when it went to sleep.
+
+   The "spinner" thread spins for most of a second and then blocks
+   on a semaphore, with a high recent_cpu and so a low priority.
+   The "nice" thread sets its niceness to 5 and blocks right away,
+   with a low recent_cpu and so a higher priority than the spinner
+   at that point.  While both sleep for 3 seconds, the spinner's
+   recent_cpu decays to about 0 (priority about 63), while the nice
+   thread's settles near 5 (priority about 52).  The first sema_up
+   must therefore wake the spinner. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct waiters
+  {
+    struct semaphore sema;      /* Both threads wait here. */
+    struct semaphore done;      /* Upped by a thread once it wakes. */
+  };
+
+static void spinner_thread (void *);
+static void nice_thread (void *);
+
+void
+test_mlfqs_waiters (void) 
+{
+  struct waiters w;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&w.sema, 0);
+  sema_init (&w.done, 0);
+
+  /* Start at a second boundary, so the spinner starts with a
+     recent_cpu near 0 and spins for most of the next second. */
+  timer_sleep (TIMER_FREQ - timer_ticks () % TIMER_FREQ);
+  msg ("Creating spinning thread.");
+  thread_create ("spinner", PRI_DEFAULT, spinner_thread, &w);
+  timer_sleep (TIMER_FREQ + TIMER_FREQ / 10);
+
+  msg ("Creating nice thread.");
+  thread_create ("nice", PRI_DEFAULT, nice_thread, &w);
+  timer_sleep (3 * TIMER_FREQ);
+
+  msg ("Waking one waiter.");
+  sema_up (&w.sema);
+  sema_down (&w.done);
+
+  msg ("Waking the other waiter.");
+  sema_up (&w.sema);
+  sema_down (&w.done);
+}
+
+static void
+spinner_thread (void *w_) 
+{
+  struct waiters *w = w_;
+
+  while (timer_ticks () % TIMER_FREQ < TIMER_FREQ - TIMER_FREQ / 10)
+    continue;
+
+  msg ("Spinning thread blocking.");
+  sema_down (&w->sema);
+  msg ("Spinning thread woke up.");
+  sema_up (&w->done);
+}
+
+static void
+nice_thread (void *w_) 
+{
+  struct waiters *w = w_;
+
+  thread_set_nice (5);
+
+  msg ("Nice thread blocking.");
+  sema_down (&w->sema);
+  msg ("Nice thread woke up.");
+  sema_up (&w->done);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-waiters) begin
+(mlfqs-waiters) Creating spinning thread.
+(mlfqs-waiters) Spinning thread blocking.
+(mlfqs-waiters) Creating nice thread.
+(mlfqs-waiters) Nice thread blocking.
+(mlfqs-waiters) Waking one waiter.
+(mlfqs-waiters) Spinning thread woke up.
+(mlfqs-waiters) Waking the other waiter.
+(mlfqs-waiters) Nice thread woke up.
+(mlfqs-waiters) end
+EOF
+pass;
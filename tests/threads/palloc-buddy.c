@@ -0,0 +1,116 @@
+/* Checks that the page allocator splits and merges buddy blocks.
+
+   First takes every free page of the kernel pool, BLOCK_PAGES
+   at a time and then one at a time, so that nothing else is
+   free.  Then it gives back a single block and carves it up:
+   the pieces must come out of that block at the offsets a buddy
+   split leaves them.  Freeing the pieces again must merge them
+   back into one block that can be handed out whole.  At the end
+   everything is freed and the free page count must match the
+   count before the test. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Order of the block the test splits. */
+#define BLOCK_ORDER 6
+#define BLOCK_PAGES (1 << BLOCK_ORDER)
+
+/* Allocated pages are chained through their first word. */
+static void
+push (void **head, void *page)
+{
+  *(void **) page = *head;
+  *head = page;
+}
+
+static void *
+pop (void **head)
+{
+  void *page = *head;
+
+  *head = *(void **) page;
+  return page;
+}
+
+/* Returns PAGE's page index within the kernel pool. */
+static size_t
+pool_idx (void *page)
+{
+  void *base;
+
+  palloc_pool_range (0, &base);
+  return pg_no (page) - pg_no (base);
+}
+
+static void
+expect (void *page, void *want, const char *what)
+{
+  if (page != want)
+    fail ("%s at %p, expected %p", what, page, want);
+}
+
+void
+test_palloc_buddy (void)
+{
+  size_t before = palloc_free_cnt (0);
+  void *blocks = NULL, *pages = NULL;
+  void *block, *p1, *p2, *p4, *p;
+  size_t block_cnt = 0;
+
+  /* Take every free page. */
+  while ((p = palloc_get_multiple (0, BLOCK_PAGES)) != NULL)
+    {
+      if (pool_idx (p) % BLOCK_PAGES != 0)
+        fail ("%d-page block at pool index %zu is not aligned",
+              BLOCK_PAGES, pool_idx (p));
+      push (&blocks, p);
+      block_cnt++;
+    }
+  while ((p = palloc_get_page (0)) != NULL)
+    push (&pages, p);
+  if (block_cnt == 0)
+    fail ("no free %d-page block in the kernel pool", BLOCK_PAGES);
+  if (palloc_free_cnt (0) != 0)
+    fail ("%zu pages still free after taking them all",
+          palloc_free_cnt (0));
+  msg ("Took every free page of the kernel pool.");
+
+  /* Split one block. */
+  block = pop (&blocks);
+  palloc_free_multiple (block, BLOCK_PAGES);
+  p1 = palloc_get_page (0);
+  expect (p1, block, "first page");
+  p = palloc_get_page (0);
+  expect (p, block + PGSIZE, "second page");
+  p2 = palloc_get_multiple (0, 2);
+  expect (p2, block + 2 * PGSIZE, "2-page block");
+  p4 = palloc_get_multiple (0, 4);
+  expect (p4, block + 4 * PGSIZE, "4-page block");
+  msg ("Split pieces come from the freed block in buddy order.");
+
+  /* Merge it back. */
+  palloc_free_page (p);
+  palloc_free_multiple (p4, 4);
+  palloc_free_page (p1);
+  palloc_free_multiple (p2, 2);
+  if (palloc_free_cnt (0) != BLOCK_PAGES)
+    fail ("%zu pages free after freeing the pieces, expected %d",
+          palloc_free_cnt (0), BLOCK_PAGES);
+  p = palloc_get_multiple (0, BLOCK_PAGES);
+  expect (p, block, "merged block");
+  msg ("Freed pieces merge back into one block.");
+
+  /* Give everything back. */
+  palloc_free_multiple (p, BLOCK_PAGES);
+  while (blocks != NULL)
+    palloc_free_multiple (pop (&blocks), BLOCK_PAGES);
+  while (pages != NULL)
+    palloc_free_page (pop (&pages));
+  if (palloc_free_cnt (0) != before)
+    fail ("%zu pages free at the end, %zu before the test",
+          palloc_free_cnt (0), before);
+  msg ("Free page count is back to where it started.");
+}
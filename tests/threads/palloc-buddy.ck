@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Took every free page of the kernel pool.
+(palloc-buddy) Split pieces come from the freed block in buddy order.
+(palloc-buddy) Freed pieces merge back into one block.
+(palloc-buddy) Free page count is back to where it started.
+(palloc-buddy) end
+EOF
+pass;
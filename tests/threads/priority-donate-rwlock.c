@@ -0,0 +1,79 @@
+/* The main thread holds a reader-writer lock for reading, along
+   with more read holds than fit in struct thread.  A
+   higher-priority writer then waits for the readers to leave,
+   donating its priority to the main thread.  A reader created
+   after that must queue behind the writer.  When the main thread
+   drops its read hold, the writer should run first, then the
+   reader, and the main thread should be back at its own
+   priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define EXTRA_CNT (RWLOCK_READ_INLINE + 2)
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_priority_donate_rwlock (void)
+{
+  struct rwlock rw;
+  struct rwlock extra[EXTRA_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_read_acquire (&rw);
+  for (i = 0; i < EXTRA_CNT; i++)
+    {
+      rwlock_init (&extra[i]);
+      rwlock_read_acquire (&extra[i]);
+    }
+  msg ("Holding %d rwlocks for reading.", EXTRA_CNT + 1);
+
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rw);
+
+  for (i = 0; i < EXTRA_CNT; i++)
+    rwlock_read_release (&extra[i]);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+
+  rwlock_read_release (&rw);
+  msg ("writer, reader must already have finished, in that order.");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_write_acquire (rw);
+  msg ("writer: got the lock");
+  rwlock_write_release (rw);
+  msg ("writer: done");
+}
+
+static void
+reader_thread_func (void *rw_)
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_read_acquire (rw);
+  msg ("reader: got the lock");
+  rwlock_read_release (rw);
+  msg ("reader: done");
+}
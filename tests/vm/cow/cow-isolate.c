@@ -0,0 +1,67 @@
+/* Checks that after fork the parent and the child each get their
+   own copy of a page as soon as they write to it: neither of them
+   may see what the other one wrote. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT (sizeof large / PAGE_SIZE)
+
+/* Writes MARK to the first byte of every other page of large,
+   starting from page FIRST. */
+static void
+mark_pages (size_t first, char mark)
+{
+	size_t i;
+
+	for (i = first; i < PAGE_CNT; i += 2)
+		large[i * PAGE_SIZE] = mark;
+}
+
+/* Returns true if every other page of large, starting from page
+   MINE, starts with MARK and all the others still start with
+   their original byte. */
+static bool
+check_pages (size_t mine, char mark, const char *orig)
+{
+	size_t i;
+
+	for (i = 0; i < PAGE_CNT; i++) {
+		char want = i % 2 == mine ? mark : orig[i];
+		if (large[i * PAGE_SIZE] != want)
+			return false;
+	}
+	return true;
+}
+
+void
+test_main (void)
+{
+	static char orig[PAGE_CNT];
+	pid_t child;
+	size_t i;
+
+	/* Fault in every page of large before forking. */
+	for (i = 0; i < PAGE_CNT; i++)
+		orig[i] = large[i * PAGE_SIZE];
+
+	child = fork ("child");
+	if (child == 0) {
+		mark_pages (0, '#');
+		CHECK (check_pages (0, '#', orig), "child sees only its own writes");
+		return;
+	}
+
+	/* The parent writes while the child may still be running, so
+	   it does not print anything until the child is done. */
+	mark_pages (1, '$');
+	CHECK (wait (child) == 0, "wait for child");
+	CHECK (check_pages (1, '$', orig), "parent sees only its own writes");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-isolate) begin
+(cow-isolate) child sees only its own writes
+(cow-isolate) end
+(cow-isolate) wait for child
+(cow-isolate) parent sees only its own writes
+(cow-isolate) end
+EOF
+pass;
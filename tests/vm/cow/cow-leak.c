@@ -0,0 +1,46 @@
+/* Forks many children that each write to every page of a large
+   array shared with the parent and then exit.  Every write makes
+   a private copy of a page, so a child holds as many frames as
+   the parent.  If exit does not give those frames back, memory
+   runs out after a few children and the later ones fail. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT (sizeof large / PAGE_SIZE)
+#define CHILD_CNT 40
+
+void
+test_main (void)
+{
+	char *buf = "Lorem ipsum";
+	volatile char *p = large;
+	size_t i, j;
+
+	/* Dirty every page of large before forking, so that all of
+	   them are shared copy-on-write. */
+	for (j = 0; j < PAGE_CNT; j++)
+		p[j * PAGE_SIZE] = p[j * PAGE_SIZE];
+
+	for (i = 0; i < CHILD_CNT; i++) {
+		pid_t child = fork ("child");
+
+		if (child == 0) {
+			for (j = 0; j < PAGE_CNT; j++)
+				large[j * PAGE_SIZE] = '@';
+			exit (0);
+		}
+		if (child < 0)
+			fail ("fork #%zu failed", i);
+		if (wait (child) != 0)
+			fail ("child #%zu failed", i);
+	}
+	msg ("forked and waited for %d children", CHILD_CNT);
+	CHECK (memcmp (buf, large, strlen (buf)) == 0, "check data consistency");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-leak) begin
+(cow-leak) forked and waited for 40 children
+(cow-leak) check data consistency
+(cow-leak) end
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* Checks that the first write to an untouched, 2 MB aligned part
+ * of a zero-filled region maps it with one 2 MB page, and that fork
+ * splits that page correctly.  The parent writes every page of the
+ * window, which must then sit in one physically contiguous, 2 MB
+ * aligned block.  The child must see the same frames, and writing
+ * one page must give the child a private copy of that page only.
+ * The parent's window must keep its frames and contents. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (2 * 1024 * 1024)
+#define HUGE_PAGES (HUGE_SIZE / PAGE_SIZE)
+#define CHILD_PAGE 5
+
+static char zeros[2 * HUGE_SIZE];
+
+void
+test_main (void)
+{
+	char *window = (char *) (((uintptr_t) zeros + HUGE_SIZE - 1) & ~(uintptr_t) (HUGE_SIZE - 1));
+	char *pa;
+	pid_t child;
+	size_t i;
+
+	for (i = 0; i < HUGE_PAGES; i++)
+		memset (window + i * PAGE_SIZE, i & 0xff, PAGE_SIZE);
+
+	pa = get_phys_addr (window);
+	CHECK (((uintptr_t) pa & (HUGE_SIZE - 1)) == 0, "window starts on a 2 MB frame");
+	for (i = 1; i < HUGE_PAGES; i++)
+		if (get_phys_addr (window + i * PAGE_SIZE) != pa + i * PAGE_SIZE)
+			fail ("page %zu is not in the 2 MB frame", i);
+	msg ("window is one 2 MB frame");
+
+	child = fork ("child");
+	if (child == 0) {
+		for (i = 0; i < HUGE_PAGES; i++)
+			if (get_phys_addr (window + i * PAGE_SIZE) != pa + i * PAGE_SIZE)
+				fail ("child page %zu is not shared", i);
+		msg ("child shares the 2 MB frame");
+
+		window[CHILD_PAGE * PAGE_SIZE] = 'x';
+		for (i = 0; i < HUGE_PAGES; i++) {
+			char *page_pa = get_phys_addr (window + i * PAGE_SIZE);
+
+			if (i == CHILD_PAGE ? page_pa == pa + i * PAGE_SIZE : page_pa != pa + i * PAGE_SIZE)
+				fail ("child page %zu has the wrong frame after the write", i);
+		}
+		msg ("child copied only the page it wrote");
+		return;
+	}
+	CHECK (wait (child) == 0, "wait for child");
+
+	for (i = 0; i < HUGE_PAGES; i++) {
+		if (get_phys_addr (window + i * PAGE_SIZE) != pa + i * PAGE_SIZE)
+			fail ("parent page %zu moved", i);
+		if (window[i * PAGE_SIZE] != (char) (i & 0xff))
+			fail ("parent page %zu changed", i);
+	}
+	msg ("parent window is intact");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-fork) begin
+(huge-fork) window starts on a 2 MB frame
+(huge-fork) window is one 2 MB frame
+(huge-fork) child shares the 2 MB frame
+(huge-fork) child copied only the page it wrote
+(huge-fork) end
+(huge-fork) wait for child
+(huge-fork) parent window is intact
+(huge-fork) end
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Checks that a 2 MB page is split correctly when memory runs out.
+ * Writes every page of a 2 MB aligned window, which must be mapped
+ * with one 2 MB page, then writes more pages than fit in memory so
+ * that the window is evicted a page at a time.  Every page of the
+ * window must come back with its own contents.
+ * For this test, Pintos memory size is 10MB. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (2 * 1024 * 1024)
+#define HUGE_PAGES (HUGE_SIZE / PAGE_SIZE)
+#define PRESSURE_SIZE (12 * 1024 * 1024)
+
+static char zeros[2 * HUGE_SIZE];
+static char pressure[PRESSURE_SIZE];
+
+void
+test_main (void)
+{
+	char *window = (char *) (((uintptr_t) zeros + HUGE_SIZE - 1) & ~(uintptr_t) (HUGE_SIZE - 1));
+	char *pa;
+	size_t i, moved;
+
+	for (i = 0; i < HUGE_PAGES; i++)
+		memset (window + i * PAGE_SIZE, i & 0xff, PAGE_SIZE);
+
+	pa = get_phys_addr (window);
+	CHECK (((uintptr_t) pa & (HUGE_SIZE - 1)) == 0, "window starts on a 2 MB frame");
+	for (i = 1; i < HUGE_PAGES; i++)
+		if (get_phys_addr (window + i * PAGE_SIZE) != pa + i * PAGE_SIZE)
+			fail ("page %zu is not in the 2 MB frame", i);
+	msg ("window is one 2 MB frame");
+
+	for (i = 0; i < PRESSURE_SIZE; i += PAGE_SIZE)
+		pressure[i] = 1;
+	for (i = 0, moved = 0; i < HUGE_PAGES; i++)
+		if (get_phys_addr (window + i * PAGE_SIZE) != pa + i * PAGE_SIZE)
+			moved++;
+	CHECK (moved > 0, "window was evicted");
+
+	for (i = 0; i < HUGE_PAGES; i++) {
+		size_t j;
+
+		for (j = 0; j < PAGE_SIZE; j++)
+			if (window[i * PAGE_SIZE + j] != (char) (i & 0xff))
+				fail ("page %zu byte %zu is wrong", i, j);
+	}
+	msg ("window is intact");
+}
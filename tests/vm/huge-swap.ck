@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-swap) begin
+(huge-swap) window starts on a 2 MB frame
+(huge-swap) window is one 2 MB frame
+(huge-swap) window was evicted
+(huge-swap) window is intact
+(huge-swap) end
+EOF
+pass;
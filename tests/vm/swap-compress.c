@@ -0,0 +1,64 @@
+/* Checks that evicted pages come back intact whether or not they
+ * compress well.  Fills more pages than fit in memory, alternating
+ * pages of repeated text, which the compressed swap cache keeps,
+ * with pages of random bytes, which go to the swap disk, and then
+ * checks every page against a freshly generated copy.
+ * For this test, Pintos memory size is 10MB. */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/arc4.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1 << PAGE_SHIFT)
+#define ONE_MB (1 << 20) // 1MB
+#define CHUNK_SIZE (12*ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunks[CHUNK_SIZE];
+
+/* Generates the contents of page IDX into BUF.  Even pages repeat
+ * a line naming the page, odd pages are random. */
+static void
+fill_page (char *buf, size_t idx)
+{
+	if (idx % 2 == 0) {
+		char line[32];
+		size_t len = snprintf (line, sizeof line, "page %zu compresses\n", idx);
+		size_t ofs;
+
+		for (ofs = 0; ofs < PAGE_SIZE; ofs += len)
+			memcpy (buf + ofs, line, ofs + len <= PAGE_SIZE ? len : PAGE_SIZE - ofs);
+	} else {
+		struct arc4 arc4;
+
+		memset (buf, 0, PAGE_SIZE);
+		arc4_init (&arc4, &idx, sizeof idx);
+		arc4_crypt (&arc4, buf, PAGE_SIZE);
+	}
+}
+
+void
+test_main (void)
+{
+	static char expected[PAGE_SIZE];
+	size_t i;
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		if (!(i % 1024))
+			msg ("write page %zu", i);
+		fill_page (big_chunks + i * PAGE_SIZE, i);
+	}
+
+	for (i = 0; i < PAGE_COUNT; i++) {
+		fill_page (expected, i);
+		if (memcmp (big_chunks + i * PAGE_SIZE, expected, PAGE_SIZE))
+			fail ("page %zu is inconsistent", i);
+		if (!(i % 1024))
+			msg ("check consistency in page %zu", i);
+	}
+}
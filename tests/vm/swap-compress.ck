@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-compress) begin
+(swap-compress) write page 0
+(swap-compress) write page 1024
+(swap-compress) write page 2048
+(swap-compress) check consistency in page 0
+(swap-compress) check consistency in page 1024
+(swap-compress) check consistency in page 2048
+(swap-compress) end
+EOF
+pass;
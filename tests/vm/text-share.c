@@ -0,0 +1,87 @@
+/* Checks that processes running the same executable share its
+   read-only text pages and nothing else.  The parent records the
+   frames of its code and of a data page it has written, then
+   runs itself twice, one child after the other, passing those
+   frames on the command line.  Each child must find its code in
+   the parent's frame, and must get a fresh copy of the data page
+   with the contents the executable was built with.  The second
+   child shows that the first one's exit unlinked its pages
+   without taking the parent's frame out of the text cache. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define CHILD_CNT 2
+
+static char data[4096] = {'d'};
+
+int main (int argc, char *argv[]);
+
+static uintptr_t
+parse_hex (const char *s)
+{
+  uintptr_t x = 0;
+
+  for (; *s != '\0'; s++)
+    x = x * 16 + (*s >= 'a' ? *s - 'a' + 10 : *s - '0');
+  return x;
+}
+
+static int
+child (char *argv[])
+{
+  void *text_pa = (void *) parse_hex (argv[2]);
+  void *data_pa = (void *) parse_hex (argv[3]);
+
+  if (get_phys_addr ((void *) main) != text_pa)
+    fail ("child %s does not share the parent's text frame", argv[1]);
+  if (data[0] != 'd')
+    fail ("child %s sees the parent's data", argv[1]);
+  data[0] = 'c';
+  if (get_phys_addr (data) == data_pa)
+    fail ("child %s shares the parent's data frame", argv[1]);
+  msg ("child %s shares only the text frame", argv[1]);
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  void *text_pa, *data_pa;
+  int i;
+
+  test_name = "text-share";
+  if (argc == 4)
+    return child (argv);
+
+  msg ("begin");
+  data[0] = 'p';
+  text_pa = get_phys_addr ((void *) main);
+  data_pa = get_phys_addr (data);
+
+  for (i = 1; i <= CHILD_CNT; i++)
+    {
+      char cmd[128];
+      pid_t pid;
+
+      snprintf (cmd, sizeof cmd, "text-share %d %llx %llx", i,
+                (unsigned long long) (uintptr_t) text_pa,
+                (unsigned long long) (uintptr_t) data_pa);
+      if (!(pid = fork ("text-share")))
+        exec (cmd);
+      if (pid < 0)
+        fail ("fork child %d returned %d", i, pid);
+      if (wait (pid) != 0)
+        fail ("child %d failed", i);
+    }
+
+  if (get_phys_addr ((void *) main) != text_pa)
+    fail ("parent's text moved");
+  if (data[0] != 'p' || get_phys_addr (data) != data_pa)
+    fail ("parent's data changed");
+  msg ("parent's pages are intact");
+  msg ("end");
+  return 0;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(text-share) begin
+(text-share) child 1 shares only the text frame
+(text-share) child 2 shares only the text frame
+(text-share) parent's pages are intact
+(text-share) end
+EOF
+pass;
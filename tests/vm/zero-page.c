@@ -0,0 +1,80 @@
+/* Checks that reading untouched BSS maps every page to the one
+ * shared zero frame, and that writing a page gives it a private
+ * zero-filled frame without touching the others.  A forked child
+ * must see the same state, and its own write must not show up in
+ * the parent. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 256
+#define PARENT_PAGE 17
+#define CHILD_PAGE 42
+
+static char bss[(PAGE_CNT + 1) * PAGE_SIZE];
+
+/* Checks that every byte of PAGES except page SKIP is zero and maps
+   to ZERO_PA. */
+static void
+check_zero (char *pages, char *zero_pa, size_t skip)
+{
+	size_t i, j;
+
+	for (i = 0; i < PAGE_CNT; i++) {
+		char *page = pages + i * PAGE_SIZE;
+
+		if (i == skip)
+			continue;
+		for (j = 0; j < PAGE_SIZE; j++)
+			if (page[j] != 0)
+				fail ("byte %zu of page %zu is %d", j, i, page[j]);
+		if (get_phys_addr (page) != zero_pa)
+			fail ("page %zu is not the zero frame", i);
+	}
+}
+
+void
+test_main (void)
+{
+	char *pages = (char *) (((uintptr_t) bss + PAGE_SIZE - 1) & ~(uintptr_t) (PAGE_SIZE - 1));
+	char *zero_pa, *page;
+	pid_t child;
+	size_t j;
+
+	/* Reading the first page maps the zero frame. */
+	CHECK (pages[0] == 0, "read the first page");
+	zero_pa = get_phys_addr (pages);
+	check_zero (pages, zero_pa, PAGE_CNT);
+	msg ("all pages read as zero from one frame");
+
+	page = pages + PARENT_PAGE * PAGE_SIZE;
+	page[0] = 'p';
+	CHECK (get_phys_addr (page) != zero_pa, "written page has its own frame");
+	for (j = 1; j < PAGE_SIZE; j++)
+		if (page[j] != 0)
+			fail ("byte %zu of the written page is %d", j, page[j]);
+	check_zero (pages, zero_pa, PARENT_PAGE);
+	msg ("other pages still read as zero from the zero frame");
+
+	child = fork ("child");
+	if (child == 0) {
+		if (page[0] != 'p')
+			fail ("child does not see the parent's write");
+		check_zero (pages, zero_pa, PARENT_PAGE);
+		pages[CHILD_PAGE * PAGE_SIZE] = 'c';
+		if (get_phys_addr (pages + CHILD_PAGE * PAGE_SIZE) == zero_pa)
+			fail ("child's write went to the zero frame");
+		msg ("child sees the same pages and writes its own");
+		return;
+	}
+	CHECK (wait (child) == 0, "wait for child");
+
+	if (page[0] != 'p')
+		fail ("parent's write is lost");
+	check_zero (pages, zero_pa, PARENT_PAGE);
+	msg ("child's write did not reach the parent");
+}
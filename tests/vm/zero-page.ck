@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page) begin
+(zero-page) read the first page
+(zero-page) all pages read as zero from one frame
+(zero-page) written page has its own frame
+(zero-page) other pages still read as zero from the zero frame
+(zero-page) child sees the same pages and writes its own
+(zero-page) end
+(zero-page) wait for child
+(zero-page) child's write did not reach the parent
+(zero-page) end
+EOF
+pass;
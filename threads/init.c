@@ -15,6 +15,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "intrinsic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -55,6 +56,7 @@ bool thread_tests;
 
 static void bss_init(void);
 static void paging_init(uint64_t mem_end);
+static uint64_t direct_map_size(uint64_t va, uint64_t left, bool gbpages);
 
 static char **read_command_line(void);
 static char **parse_options(char **argv);
@@ -141,27 +143,66 @@ static void bss_init(void) {
 /* 커널 가상 매핑으로 페이지 테이블을 채운 다음 새 페이지 디렉터리를 사용하
  * 도록 CPU를 설정합니다.
  * base_pml4부터 pml4를 가리킵니다. */
+/** #Large Page direct map은 가능한 한 2 MB(CPU가 지원하면 1 GB) 페이지로 만들어 페이지 테이블과
+ *  TLB 항목을 줄인다. 읽기 전용인 커널 text의 경계가 걸친 부분만 4 KB 페이지로 둔다. */
 static void paging_init(uint64_t mem_end) {
     uint64_t *pml4, *pte;
     int perm;
+    uint32_t eax, ebx, ecx, edx;
+    bool gbpages = false;
     pml4 = base_pml4 = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 
+    cpuid(0x80000000, 0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000001) {
+        cpuid(0x80000001, 0, &eax, &ebx, &ecx, &edx);
+        gbpages = (edx & (1 << 26)) != 0;
+    }
+
     extern char start, _end_kernel_text;
     // Maps physical address [0 ~ mem_end] to
     //   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-    for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+    for (uint64_t pa = 0, size; pa < mem_end; pa += size) {
         uint64_t va = (uint64_t)ptov(pa);
 
+        size = direct_map_size(va, mem_end - pa, gbpages);
         perm = PTE_P | PTE_W;
         if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
             perm &= ~PTE_W;
 
-        if ((pte = pml4e_walk(pml4, va, 1)) != NULL)
+        if (size == PGSIZE)
+            pte = pml4e_walk(pml4, va, 1);
+        else {
+            pte = pml4e_walk_large(pml4, va, size);
+            perm |= PTE_PS;
+        }
+        if (pte != NULL)
             *pte = pa | perm;
     }
 
     // reload cr3
     pml4_activate(0);
+    pml4_pcid_init();
+}
+
+/** #Large Page direct map에서 VA부터 매핑할 페이지 크기. VA가 그 크기로 정렬되어 있고, 남은 LEFT 바이트
+ *  안에 들어가며, 커널 text의 시작이나 끝이 그 안에 걸치지 않는 가장 큰 크기를 고른다. */
+static uint64_t direct_map_size(uint64_t va, uint64_t left, bool gbpages) {
+    extern char start, _end_kernel_text;
+    uint64_t text_start = (uint64_t)&start, text_end = (uint64_t)&_end_kernel_text;
+    uint64_t sizes[] = {PGSIZE_1G, PGSIZE_2M};
+
+    for (size_t i = gbpages ? 0 : 1; i < sizeof sizes / sizeof *sizes; i++) {
+        uint64_t size = sizes[i];
+        uint64_t end = va + size;
+
+        if (va % size != 0 || size > left)
+            continue;
+        /* 통째로 text 안이거나 text 밖이어야 한 가지 권한으로 매핑할 수 있다 */
+        if ((text_start > va && text_start < end) || (text_end > va && text_end < end))
+            continue;
+        return size;
+    }
+    return PGSIZE;
 }
 
 /* 커널 명령줄을 단어로 나누고 이를 argv와 같은 배열로 반환합니다. */
@@ -215,11 +256,17 @@ static char **parse_options(char **argv) {
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
         else if (!strcmp(name, "-threads-tests"))
             thread_tests = true;
+#endif
+#ifdef VM
+        else if (!strcmp(name, "-fa"))
+            fault_around_pages = atoi(value);
 #endif
         else
             PANIC("unknown option `%s' (use -h for help)", name);
@@ -313,8 +360,12 @@ static void usage(void) {
         "  -f                 Format file system disk during startup.\n"
         "  -rs=SEED           Set random number seed to SEED.\n"
         "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+        "  -tickless          Stop the periodic timer tick while idle.\n"
 #ifdef USERPROG
         "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+        "  -fa=COUNT          Populate up to COUNT pages per file-backed fault.\n"
 #endif
     );
     power_off();
@@ -347,4 +398,7 @@ static void print_stats(void) {
 #ifdef USERPROG
     exception_print_stats();
 #endif
+#ifdef VM
+    vm_print_stats();
+#endif
 }
@@ -9,6 +9,7 @@
 
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -34,7 +35,15 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   In front of the descriptors, each thread keeps a small stack
+   of free blocks per size class, its "magazine".  malloc() and
+   free() use the magazine without taking any lock, and only go
+   to the descriptor to refill or drain half a magazine at a
+   time.  Blocks sitting in a magazine still count as in use for
+   their arena, so an arena is only returned to the page
+   allocator once its blocks come back through the descriptor. */
 
 /* Descriptor. */
 struct desc {
@@ -42,6 +51,7 @@ struct desc {
     size_t blocks_per_arena; /* Number of blocks in an arena. */
     struct list free_list;   /* List of free blocks. */
     struct lock lock;        /* Lock. */
+    size_t mag_capacity;     /* Max blocks in a thread's magazine. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -56,7 +66,10 @@ struct arena {
 
 /* Free block. */
 struct block {
-    struct list_elem free_elem; /* Free list element. */
+    union {
+        struct list_elem free_elem; /* Free list element. */
+        struct block *mag_next;     /* Next block in a magazine. */
+    };
 };
 
 /* Our set of descriptors. */
@@ -65,6 +78,10 @@ static size_t desc_cnt;       /* Number of descriptors. */
 
 static struct arena *block_to_arena(struct block *);
 static struct block *arena_to_block(struct arena *, size_t idx);
+static struct block *desc_get_block(struct desc *, bool new_arena);
+static void desc_put_block(struct desc *, struct block *);
+static bool magazine_refill(struct desc *, struct magazine *);
+static void magazine_drain(struct desc *, struct magazine *, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void malloc_init(void) {
@@ -77,7 +94,15 @@ void malloc_init(void) {
         d->blocks_per_arena = (PGSIZE - sizeof(struct arena)) / block_size;
         list_init(&d->free_list);
         lock_init(&d->lock);
+
+        /* Keep about 1 kB per magazine so big classes don't pin whole arenas. */
+        d->mag_capacity = 1024 / block_size;
+        if (d->mag_capacity > MAGAZINE_SIZE)
+            d->mag_capacity = MAGAZINE_SIZE;
+        if (d->mag_capacity == 0)
+            d->mag_capacity = 1;
     }
+    ASSERT(desc_cnt == MAGAZINE_CLASS_CNT);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -86,6 +111,7 @@ void *malloc(size_t size) {
     struct desc *d;
     struct block *b;
     struct arena *a;
+    struct magazine *mag;
 
     /* A null pointer satisfies a request for 0 bytes. */
     if (size == 0)
@@ -112,18 +138,40 @@ void *malloc(size_t size) {
         return a + 1;
     }
 
-    lock_acquire(&d->lock);
+    /* Take a block from this thread's magazine, refilling it from
+       the descriptor if it is empty. */
+    ASSERT(!intr_context());
+    mag = &thread_current()->magazines[d - descs];
+    if (mag->cnt == 0 && !magazine_refill(d, mag))
+        return NULL;
+
+    b = mag->top;
+    mag->top = b->mag_next;
+    mag->cnt--;
+    return b;
+}
+
+/* Removes a block from D's free list and returns it.  If the
+   free list is empty, creates a new arena when NEW_ARENA is
+   true, otherwise returns a null pointer.  Also returns a null
+   pointer if no page is available.  D's lock must be held. */
+static struct block *desc_get_block(struct desc *d, bool new_arena) {
+    struct block *b;
+    struct arena *a;
+
+    ASSERT(lock_held_by_current_thread(&d->lock));
 
     /* If the free list is empty, create a new arena. */
     if (list_empty(&d->free_list)) {
         size_t i;
 
+        if (!new_arena)
+            return NULL;
+
         /* Allocate a page. */
         a = palloc_get_page(0);
-        if (a == NULL) {
-            lock_release(&d->lock);
+        if (a == NULL)
             return NULL;
-        }
 
         /* Initialize arena and add its blocks to the free list. */
         a->magic = ARENA_MAGIC;
@@ -139,10 +187,82 @@ void *malloc(size_t size) {
     b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
     a = block_to_arena(b);
     a->free_cnt--;
-    lock_release(&d->lock);
     return b;
 }
 
+/* Returns block B to D's free list, giving its arena back to the
+   page allocator if it is now entirely unused.  D's lock must be
+   held. */
+static void desc_put_block(struct desc *d, struct block *b) {
+    struct arena *a = block_to_arena(b);
+
+    ASSERT(lock_held_by_current_thread(&d->lock));
+
+    /* Add block to free list. */
+    list_push_front(&d->free_list, &b->free_elem);
+
+    /* If the arena is now entirely unused, free it. */
+    if (++a->free_cnt >= d->blocks_per_arena) {
+        size_t i;
+
+        ASSERT(a->free_cnt == d->blocks_per_arena);
+        for (i = 0; i < d->blocks_per_arena; i++) {
+            struct block *b = arena_to_block(a, i);
+            list_remove(&b->free_elem);
+        }
+        palloc_free_page(a);
+    }
+}
+
+/* Fills empty magazine MAG with up to half its capacity of
+   blocks from D, under a single acquisition of D's lock.  A new
+   arena is only created if D has no free block at all.  Returns
+   false if no block could be obtained. */
+static bool magazine_refill(struct desc *d, struct magazine *mag) {
+    size_t batch = (d->mag_capacity + 1) / 2;
+
+    ASSERT(mag->cnt == 0);
+
+    lock_acquire(&d->lock);
+    while (mag->cnt < batch) {
+        struct block *b = desc_get_block(d, mag->cnt == 0);
+        if (b == NULL)
+            break;
+        b->mag_next = mag->top;
+        mag->top = b;
+        mag->cnt++;
+    }
+    lock_release(&d->lock);
+
+    return mag->cnt > 0;
+}
+
+/* Moves CNT blocks from magazine MAG back to D under a single
+   acquisition of D's lock. */
+static void magazine_drain(struct desc *d, struct magazine *mag, size_t cnt) {
+    ASSERT(cnt <= mag->cnt);
+
+    lock_acquire(&d->lock);
+    while (cnt-- > 0) {
+        struct block *b = mag->top;
+        mag->top = b->mag_next;
+        mag->cnt--;
+        desc_put_block(d, b);
+    }
+    lock_release(&d->lock);
+}
+
+/* Returns every block in the current thread's magazines to its
+   descriptor.  Called when the thread exits. */
+void malloc_drain(void) {
+    struct thread *t = thread_current();
+    size_t i;
+
+    for (i = 0; i < desc_cnt; i++)
+        if (t->magazines[i].cnt > 0)
+            magazine_drain(&descs[i], &t->magazines[i], t->magazines[i].cnt);
+}
+
 /* Allocates and return A times B bytes initialized to zeroes.
    Returns a null pointer if memory is not available. */
 void *calloc(size_t a, size_t b) {
@@ -162,8 +282,9 @@ void *calloc(size_t a, size_t b) {
     return p;
 }
 
-/* Returns the number of bytes allocated for BLOCK. */
-static size_t block_size(void *block) {
+/* Returns the number of bytes allocated for BLOCK, which is at
+   least the size it was requested with. */
+size_t malloc_block_size(void *block) {
     struct block *b = block;
     struct arena *a = block_to_arena(b);
     struct desc *d = a->desc;
@@ -184,7 +305,7 @@ void *realloc(void *old_block, size_t new_size) {
     } else {
         void *new_block = malloc(new_size);
         if (old_block != NULL && new_block != NULL) {
-            size_t old_size = block_size(old_block);
+            size_t old_size = malloc_block_size(old_block);
             size_t min_size = new_size < old_size ? new_size : old_size;
             memcpy(new_block, old_block, min_size);
             free(old_block);
@@ -209,24 +330,16 @@ void free(void *p) {
             memset(b, 0xcc, d->block_size);
 #endif
 
-            lock_acquire(&d->lock);
-
-            /* Add block to free list. */
-            list_push_front(&d->free_list, &b->free_elem);
-
-            /* If the arena is now entirely unused, free it. */
-            if (++a->free_cnt >= d->blocks_per_arena) {
-                size_t i;
-
-                ASSERT(a->free_cnt == d->blocks_per_arena);
-                for (i = 0; i < d->blocks_per_arena; i++) {
-                    struct block *b = arena_to_block(a, i);
-                    list_remove(&b->free_elem);
-                }
-                palloc_free_page(a);
-            }
+            /* Push the block onto this thread's magazine, first
+               draining half of it to the descriptor if it is full. */
+            ASSERT(!intr_context());
+            struct magazine *mag = &thread_current()->magazines[d - descs];
+            if (mag->cnt >= d->mag_capacity)
+                magazine_drain(d, mag, (d->mag_capacity + 1) / 2);
 
-            lock_release(&d->lock);
+            b->mag_next = mag->top;
+            mag->top = b;
+            mag->cnt++;
         } else {
             /* It's a big block.  Free its pages. */
             palloc_free_multiple(a, a->free_cnt);
@@ -6,11 +6,15 @@
 
 #include "intrinsic.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 
-static uint64_t *pgdir_walk(uint64_t *pdp, const uint64_t va, int create) {
+/** #Large Page 아래 walk 함수들은 PTE_PS가 켜진 PDE/PDPTE를 만나면 더 내려가지 않고 그 entry를 반환하고,
+ *  *SIZE에 그 entry가 매핑하는 페이지 크기를 넣는다. 큰 페이지 안에 4 KB 페이지를 만들 수는 없으므로
+ *  CREATE면 NULL을 반환한다. */
+static uint64_t *pgdir_walk(uint64_t *pdp, const uint64_t va, int create, uint64_t *size) {
     int idx = PDX(va);
     if (pdp) {
         uint64_t *pte = (uint64_t *)pdp[idx];
@@ -23,13 +27,17 @@ static uint64_t *pgdir_walk(uint64_t *pdp, const uint64_t va, int create) {
                     return NULL;
             } else
                 return NULL;
+        } else if ((uint64_t)pte & PTE_PS) {
+            *size = PGSIZE_2M;
+            return create ? NULL : &pdp[idx];
         }
+        *size = PGSIZE;
         return (uint64_t *)ptov(PTE_ADDR(pdp[idx]) + 8 * PTX(va));
     }
     return NULL;
 }
 
-static uint64_t *pdpe_walk(uint64_t *pdpe, const uint64_t va, int create) {
+static uint64_t *pdpe_walk(uint64_t *pdpe, const uint64_t va, int create, uint64_t *size) {
     uint64_t *pte = NULL;
     int idx = PDPE(va);
     int allocated = 0;
@@ -45,8 +53,11 @@ static uint64_t *pdpe_walk(uint64_t *pdpe, const uint64_t va, int create) {
                     return NULL;
             } else
                 return NULL;
+        } else if ((uint64_t)pde & PTE_PS) {
+            *size = PGSIZE_1G;
+            return create ? NULL : &pdpe[idx];
         }
-        pte = pgdir_walk(ptov(PTE_ADDR(pdpe[idx])), va, create);
+        pte = pgdir_walk(ptov(PTE_ADDR(pdpe[idx])), va, create, size);
     }
     if (pte == NULL && allocated) {
         palloc_free_page((void *)ptov(PTE_ADDR(pdpe[idx])));
@@ -69,7 +80,8 @@ static uint64_t *pdpe_walk(uint64_t *pdpe, const uint64_t va, int create) {
  * (create가 false) null pointer 반환.*/
 
 /* 함수의 목적: page table entry 주소를 찾고 반환해주는 역할.*/
-uint64_t *pml4e_walk(uint64_t *pml4e, const uint64_t va, int create) {
+/** #Large Page 큰 페이지를 만나면 그 PDE/PDPTE를 반환한다. *SIZE는 반환한 entry가 매핑하는 크기 */
+static uint64_t *pml4e_walk_size(uint64_t *pml4e, const uint64_t va, int create, uint64_t *size) {
     /* va는 다음과 같은 구조를 지님
      * va = [PML4 Index] [PDPT Index] [PD Index] [Offset] 
      * 여기서 단계 별로 추적하여 특정 entry를 가리킴. 
@@ -92,7 +104,7 @@ uint64_t *pml4e_walk(uint64_t *pml4e, const uint64_t va, int create) {
             } else
                 return NULL;
         }
-        pte = pdpe_walk(ptov(PTE_ADDR(pml4e[idx])), va, create); // 확인된 or. create에 따라 새로 생성된, 
+        pte = pdpe_walk(ptov(PTE_ADDR(pml4e[idx])), va, create, size); // 확인된 or. create에 따라 새로 생성된, 
                                                                  //pdpt를 가준으로 pd index를 찾음.
     }
     if (pte == NULL && allocated) { // 새로운 PDPT를 할당한 경우, 
@@ -102,6 +114,183 @@ uint64_t *pml4e_walk(uint64_t *pml4e, const uint64_t va, int create) {
     return pte; //최종적으로 page table entry 반환.
 }
 
+uint64_t *pml4e_walk(uint64_t *pml4e, const uint64_t va, int create) {
+    uint64_t size;
+
+    return pml4e_walk_size(pml4e, va, create, &size);
+}
+
+/** #Large Page PML4에서 VA를 SIZE(PGSIZE_2M 또는 PGSIZE_1G) 크기의 큰 페이지로 매핑할 PDE/PDPTE의 주소를
+ *  반환한다. 중간 테이블은 필요하면 만든다. 그 사이에 이미 큰 페이지가 있거나 메모리가 없으면 NULL.
+ *  호출자가 PTE_PS를 켜서 채운다. */
+uint64_t *pml4e_walk_large(uint64_t *pml4, const uint64_t va, uint64_t size) {
+    uint64_t shift = size == PGSIZE_1G ? PDPESHIFT : PDXSHIFT;
+    uint64_t *table = pml4;
+
+    ASSERT(size == PGSIZE_2M || size == PGSIZE_1G);
+    ASSERT(va % size == 0);
+
+    for (uint64_t level = PML4SHIFT; level > shift; level -= 9) {
+        uint64_t *entry = &table[(va >> level) & 0x1FF];
+
+        if (!(*entry & PTE_P)) {
+            uint64_t *new_page = palloc_get_page(PAL_ZERO);
+            if (new_page == NULL)
+                return NULL;
+            *entry = vtop(new_page) | PTE_U | PTE_W | PTE_P;
+        } else if (*entry & PTE_PS)
+            return NULL;
+        table = ptov(PTE_ADDR(*entry));
+    }
+    return &table[(va >> shift) & 0x1FF];
+}
+
+/** #PCID CR3 하위 12비트의 process-context identifier(PCID)로 TLB 항목을 주소 공간별로 구분하면
+ *  cr3를 다시 읽어도 다른 주소 공간의 항목을 비우지 않아도 된다. PCID 0은 base_pml4가 쓰고,
+ *  사용자 pml4에는 최근에 쓴 PCID_SLOTS개에만 1..PCID_SLOTS를 돌려 가며 준다.
+ *  PCID를 새로 받거나 활성화되지 않은 동안 PTE가 바뀐 pml4는 다음 활성화 때 그 PCID만 비운다. */
+#define CR4_PCIDE (1 << 17)            /* CR4: PCID 사용 */
+#define CR3_NOFLUSH (1ULL << 63)       /* CR3: 새 PCID의 TLB 항목을 비우지 않음 */
+#define CPUID1_ECX_PCID (1 << 17)
+#define CPUID7_EBX_INVPCID (1 << 10)
+#define PCID_SLOTS 16
+
+struct pcid_slot {
+    uint64_t *pml4;     /* 이 PCID를 쓰는 pml4, 없으면 NULL */
+    bool stale;         /* 다음 활성화 때 이 PCID의 TLB 항목을 비워야 함 */
+};
+
+static bool pcid_enabled;
+static bool invpcid_enabled;
+static struct pcid_slot pcid_slots[PCID_SLOTS];
+static unsigned pcid_next;      /* PCID를 빼앗을 다음 slot */
+
+/** #PCID CPU가 지원하면 PCID를 켠다. base_pml4가 PCID 0으로 활성화된 뒤에 불러야 한다. */
+void pml4_pcid_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    if (eax >= 7) {
+        cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+        invpcid_enabled = (ebx & CPUID7_EBX_INVPCID) != 0;
+    }
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!(ecx & CPUID1_ECX_PCID))
+        return;
+
+    ASSERT((rcr3() & PTE_FLAGS) == 0);
+    lcr4(rcr4() | CR4_PCIDE);
+    pcid_enabled = true;
+}
+
+/* Returns the slot PML4 holds, or a null pointer.  Must be called
+   with interrupts off. */
+static struct pcid_slot *pcid_find(uint64_t *pml4) {
+    for (int i = 0; i < PCID_SLOTS; i++)
+        if (pcid_slots[i].pml4 == pml4)
+            return &pcid_slots[i];
+    return NULL;
+}
+
+/** #PCID PML4에서 VA의 PTE인 PTE의 CLEAR 비트를 지우고 SET 비트를 켠 뒤 TLB에 남은 옛 항목을 없앤다.
+ *  활성화된 pml4면 invlpg, 아니면 INVPCID로 그 PCID의 항목만 없애거나 다음 활성화 때 PCID 전체를
+ *  비우도록 표시한다. PCID가 없으면 다른 pml4의 항목은 cr3를 다시 읽을 때 모두 비워진다.
+ *  그 사이 PML4로 전환되어 옛 항목을 쓰지 않도록 인터럽트를 끈 채로 바꾼다. */
+static void pte_update(uint64_t *pml4, uint64_t *pte, const void *va, uint64_t clear, uint64_t set) {
+    enum intr_level old_level = intr_disable();
+    uint64_t old_pte = *pte;
+
+    *pte = (old_pte & ~clear) | set;
+    /* present가 아니던 PTE는 TLB에 없다 */
+    if (old_pte & PTE_P) {
+        if (PTE_ADDR(rcr3()) == vtop(pml4))
+            invlpg((uint64_t)va);
+        else if (pcid_enabled) {
+            struct pcid_slot *slot = pcid_find(pml4);
+
+            if (slot != NULL && invpcid_enabled)
+                invpcid(0, slot - pcid_slots + 1, (uint64_t)va);
+            else if (slot != NULL)
+                slot->stale = true;
+        }
+    }
+    intr_set_level(old_level);
+}
+
+/** #Huge Page 사용자 2 MB 페이지를 매핑한 PDE를 같은 내용의 4 KB PTE 512개로 쪼갠다.
+ *  주소와 권한은 그대로이므로 TLB의 큰 페이지 항목이 잠시 남아도 같은 곳을 가리킨다. */
+static void pde_split(uint64_t *pml4, uint64_t *pde, const void *va) {
+    uint64_t *pt = palloc_get_page(PAL_ASSERT);
+    uint64_t flags = *pde & PTE_FLAGS & ~(uint64_t)PTE_PS;
+
+    for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t); i++)
+        pt[i] = (PTE_ADDR(*pde) + i * PGSIZE) | flags;
+    pte_update(pml4, pde, va, ~0ULL, vtop(pt) | PTE_U | PTE_W | PTE_P);
+}
+
+/** #Huge Page VA의 4 KB PTE를 찾는다. 한 페이지만 바꿀 때 쓰므로 사용자 2 MB 페이지 안이면 먼저 쪼갠다.
+ *  CREATE면 없는 페이지 테이블을 만든다. */
+static uint64_t *pml4e_walk_split(uint64_t *pml4, const void *va, int create) {
+    uint64_t size;
+    uint64_t *pte = pml4e_walk_size(pml4, (uint64_t)va, 0, &size);
+
+    if (pte != NULL && size == PGSIZE)
+        return pte;
+    if (pte != NULL && size == PGSIZE_2M && (*pte & PTE_U))
+        pde_split(pml4, pte, va);
+    else if (pte != NULL || !create)
+        return NULL;
+    return pml4e_walk_size(pml4, (uint64_t)va, create, &size);
+}
+
+/** #Huge Page PML4에서 2 MB로 정렬된 UPAGE부터 2 MB를 물리적으로 연속되고 2 MB로 정렬된 KPAGE에
+ *  큰 페이지 하나로 매핑한다. 그 구간에 이미 페이지 테이블이 있거나 메모리가 없으면 false. */
+bool pml4_set_huge(uint64_t *pml4, void *upage, void *kpage, bool rw) {
+    uint64_t *pde;
+
+    ASSERT((uint64_t)upage % PGSIZE_2M == 0);
+    ASSERT(vtop(kpage) % PGSIZE_2M == 0);
+    ASSERT(is_user_vaddr(upage + PGSIZE_2M - 1));
+    ASSERT(pml4 != base_pml4);
+
+    pde = pml4e_walk_large(pml4, (uint64_t)upage, PGSIZE_2M);
+    if (pde == NULL || (*pde & PTE_P))
+        return false;
+    *pde = vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U | PTE_PS;
+    return true;
+}
+
+/** #Huge Page PML4에서 VPAGE가 사용자 2 MB 페이지로 매핑되어 있으면 true */
+bool pml4_is_huge(uint64_t *pml4, const void *vpage) {
+    uint64_t size;
+    uint64_t *pte = pml4e_walk_size(pml4, (uint64_t)vpage, 0, &size);
+
+    return pte != NULL && size == PGSIZE_2M && (*pte & PTE_P) && (*pte & PTE_U);
+}
+
+/** #Huge Page PML4의 사용자 2 MB 페이지 mapping을 쪼개지 않고 모두 지운다. 주소 공간을 없앨 때
+ *  4 KB씩 지우면 PDE마다 페이지 테이블을 새로 받아 쪼개야 하므로 그 전에 부른다.
+ *  물리 페이지는 돌려주지 않으며, 호출자가 4 KB frame마다 돌려준다. */
+void pml4_clear_huge(uint64_t *pml4) {
+    uint64_t *pdpe;
+
+    /* 사용자 주소는 모두 pml4[0] 아래에 있다. pml4_destroy() 참고 */
+    if (!(pml4[0] & PTE_P))
+        return;
+    pdpe = ptov(PTE_ADDR(pml4[0]));
+    for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t); i++) {
+        uint64_t *pgdir;
+
+        if (!(pdpe[i] & PTE_P) || (pdpe[i] & PTE_PS))
+            continue;
+        pgdir = ptov(PTE_ADDR(pdpe[i]));
+        for (unsigned j = 0; j < PGSIZE / sizeof(uint64_t); j++)
+            if ((pgdir[j] & (PTE_P | PTE_PS | PTE_U)) == (PTE_P | PTE_PS | PTE_U))
+                pte_update(pml4, &pgdir[j],
+                           (void *)(((uint64_t)i << PDPESHIFT) | ((uint64_t)j << PDXSHIFT)), PTE_P, 0);
+    }
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -128,7 +317,7 @@ static bool pt_for_each(uint64_t *pt, pte_for_each_func *func, void *aux, unsign
 static bool pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, unsigned pml4_index, unsigned pdp_index) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pte = ptov((uint64_t *)pdp[i]);
-        if (((uint64_t)pte) & PTE_P)
+        if ((((uint64_t)pte) & PTE_P) && !(pdp[i] & PTE_PS))
             if (!pt_for_each((uint64_t *)PTE_ADDR(pte), func, aux, pml4_index, pdp_index, i))
                 return false;
     }
@@ -138,7 +327,7 @@ static bool pgdir_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, un
 static bool pdp_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, unsigned pml4_index) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pde = ptov((uint64_t *)pdp[i]);
-        if (((uint64_t)pde) & PTE_P)
+        if ((((uint64_t)pde) & PTE_P) && !(pdp[i] & PTE_PS))
             if (!pgdir_for_each((uint64_t *)PTE_ADDR(pde), func, aux, pml4_index, i))
                 return false;
     }
@@ -146,6 +335,7 @@ static bool pdp_for_each(uint64_t *pdp, pte_for_each_func *func, void *aux, unsi
 }
 
 /* Apply FUNC to each available pte entries including kernel's. */
+/** #Large Page 커널 direct map의 큰 페이지는 4 KB PTE가 아니므로 건너뛴다. */
 bool pml4_for_each(uint64_t *pml4, pte_for_each_func *func, void *aux) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pdpe = ptov((uint64_t *)pml4[i]);
@@ -168,7 +358,10 @@ static void pt_destroy(uint64_t *pt) {
 static void pgdir_destroy(uint64_t *pdp) {
     for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
         uint64_t *pte = ptov((uint64_t *)pdp[i]);
-        if (((uint64_t)pte) & PTE_P)
+        /** #Huge Page 2 MB 페이지면 그 512 페이지를 돌려준다 */
+        if ((((uint64_t)pte) & PTE_P) && (pdp[i] & PTE_PS))
+            palloc_free_multiple(ptov(PTE_ADDR(pdp[i])), PGSIZE_2M / PGSIZE);
+        else if (((uint64_t)pte) & PTE_P)
             pt_destroy(PTE_ADDR(pte));
     }
     palloc_free_page((void *)pdp);
@@ -193,13 +386,59 @@ void pml4_destroy(uint64_t *pml4) {
     uint64_t *pdpe = ptov((uint64_t *)pml4[0]);
     if (((uint64_t)pdpe) & PTE_P)
         pdpe_destroy((void *)PTE_ADDR(pdpe));
+
+    /** #PCID 같은 페이지에 다음 pml4가 만들어져도 이 PCID를 물려받지 않도록 놓는다 */
+    if (pcid_enabled) {
+        enum intr_level old_level = intr_disable();
+        struct pcid_slot *slot = pcid_find(pml4);
+
+        if (slot != NULL)
+            slot->pml4 = NULL;
+        intr_set_level(old_level);
+    }
     palloc_free_page((void *)pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
  * register. */
+/** #PCID 이미 활성화된 pml4면 cr3를 다시 읽지 않는다. PCID를 쓰면 이 pml4의 PCID와 함께
+ *  읽어, 비울 필요가 없을 때는 TLB 항목을 그대로 둔다. */
 void pml4_activate(uint64_t *pml4) {
-    lcr3(vtop(pml4 ? pml4 : base_pml4));
+    enum intr_level old_level;
+    uint64_t cr3;
+
+    if (pml4 == NULL)
+        pml4 = base_pml4;
+    cr3 = vtop(pml4);
+    /* 활성화된 pml4의 PTE를 바꿀 때는 늘 invlpg 하므로 TLB가 이미 맞다 */
+    if (PTE_ADDR(rcr3()) == cr3)
+        return;
+    if (!pcid_enabled) {
+        lcr3(cr3);
+        return;
+    }
+
+    old_level = intr_disable();
+    if (pml4 == base_pml4) {
+        /* 커널 mapping은 부팅 후 바뀌지 않는다 */
+        cr3 |= CR3_NOFLUSH;
+    } else {
+        struct pcid_slot *slot = pcid_find(pml4);
+
+        if (slot == NULL) {
+            /* 가장 오래 전에 준 PCID를 빼앗는다. 옛 pml4의 항목이 남아 있으므로 비운다 */
+            slot = &pcid_slots[pcid_next];
+            pcid_next = (pcid_next + 1) % PCID_SLOTS;
+            slot->pml4 = pml4;
+            slot->stale = true;
+        }
+        cr3 |= slot - pcid_slots + 1;
+        if (!slot->stale)
+            cr3 |= CR3_NOFLUSH;
+        slot->stale = false;
+    }
+    lcr3(cr3);
+    intr_set_level(old_level);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -209,10 +448,12 @@ void pml4_activate(uint64_t *pml4) {
 void *pml4_get_page(uint64_t *pml4, const void *uaddr) {
     ASSERT(is_user_vaddr(uaddr));
 
-    uint64_t *pte = pml4e_walk(pml4, (uint64_t)uaddr, 0);
+    uint64_t size;
+    uint64_t *pte = pml4e_walk_size(pml4, (uint64_t)uaddr, 0, &size);
 
+    /** #Large Page 큰 페이지면 그 안에서의 offset을 더한다 */
     if (pte && (*pte & PTE_P))
-        return ptov(PTE_ADDR(*pte)) + pg_ofs(uaddr);
+        return ptov((PTE_ADDR(*pte) & ~(size - 1)) + ((uint64_t)uaddr & (size - 1)));
     return NULL;
 }
 
@@ -241,10 +482,10 @@ bool pml4_set_page(uint64_t *pml4, void *upage, void *kpage, bool rw) { // page
     ASSERT(is_user_vaddr(upage));// upage가 user address인지 확인
     ASSERT(pml4 != base_pml4); // 주어진 pml4가 현재 실행 중인 스레드의 base_pml4와 같지 않은지 확인?
 
-    uint64_t *pte = pml4e_walk(pml4, (uint64_t)upage, 1); // PML4에서 VA에 해당하는 page table entry를 찾음./pte = page table entry
+    uint64_t *pte = pml4e_walk_split(pml4, upage, 1); // PML4에서 VA에 해당하는 page table entry를 찾음./pte = page table entry
 
-    if (pte)
-        *pte = vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U; //vtop: 커널 가상 주소를 물리 주소로 변환.
+    if (pte) //vtop: 커널 가상 주소를 물리 주소로 변환. 있던 mapping을 바꿨다면 TLB의 옛 항목도 없앤다.
+        pte_update(pml4, pte, upage, ~0ULL, vtop(kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U);
     return pte != NULL; // boolean 반환.
 }
 
@@ -257,12 +498,10 @@ void pml4_clear_page(uint64_t *pml4, void *upage) {
     ASSERT(pg_ofs(upage) == 0);
     ASSERT(is_user_vaddr(upage));
 
-    pte = pml4e_walk(pml4, (uint64_t)upage, false);
+    pte = pml4e_walk_split(pml4, upage, false);
 
     if (pte != NULL && (*pte & PTE_P) != 0) {
-        *pte &= ~PTE_P;
-        if (rcr3() == vtop(pml4))
-            invlpg((uint64_t)upage);
+        pte_update(pml4, pte, upage, PTE_P, 0);
     }
 }
 
@@ -279,15 +518,8 @@ bool pml4_is_dirty(uint64_t *pml4, const void *vpage) {
  * in PML4. */
 void pml4_set_dirty(uint64_t *pml4, const void *vpage, bool dirty) {
     uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
-    if (pte) {
-        if (dirty)
-            *pte |= PTE_D;
-        else
-            *pte &= ~(uint32_t)PTE_D;
-
-        if (rcr3() == vtop(pml4))
-            invlpg((uint64_t)vpage);
-    }
+    if (pte)
+        pte_update(pml4, pte, vpage, PTE_D, dirty ? PTE_D : 0);
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 has been
@@ -303,13 +535,14 @@ bool pml4_is_accessed(uint64_t *pml4, const void *vpage) {
    VPAGE in PD. */
 void pml4_set_accessed(uint64_t *pml4, const void *vpage, bool accessed) {
     uint64_t *pte = pml4e_walk(pml4, (uint64_t)vpage, false);
-    if (pte) {
-        if (accessed)
-            *pte |= PTE_A;
-        else
-            *pte &= ~(uint32_t)PTE_A;
-
-        if (rcr3() == vtop(pml4))
-            invlpg((uint64_t)vpage);
-    }
+    if (pte)
+        pte_update(pml4, pte, vpage, PTE_A, accessed ? PTE_A : 0);
+}
+
+/** Project 3: Copy On Write (Extra) PML4에서 가상 페이지 VPAGE의 PTE에 쓰기 권한을
+ * WRITABLE로 설정한다. 다른 비트(accessed, dirty 등)는 그대로 둔다. */
+void pml4_set_writable(uint64_t *pml4, const void *vpage, bool writable) {
+    uint64_t *pte = pml4e_walk_split(pml4, vpage, false);
+    if (pte)
+        pte_update(pml4, pte, vpage, PTE_W, writable ? PTE_W : 0);
 }
@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -26,13 +27,57 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy
+   allocator.  A free block of order K is 2**K pages whose index
+   within the pool is a multiple of 2**K, and it sits on the
+   pool's order-K free list.  The list links live in an array
+   beside used_map rather than in the free pages themselves, so
+   the allocator never touches memory it hands out (at boot not
+   all of it is mapped yet).
+   Allocation splits the smallest large-enough block and freeing
+   merges a block with its buddy for as long as the buddy is also
+   free, so both are O(log n) in the pool size.  Requests that are
+   not a power of two take the next order up and give the tail
+   back.  used_map still records which pages are in use.
+
+   Each pool also keeps a small stack of pages that the idle
+   thread has already zeroed.  Single-page PAL_ZERO requests take
+   from it first, so they don't have to clear the page while the
+   caller waits.  These pages count as in use in used_map, but
+   palloc_free_cnt() still reports them as free, so every
+   allocation path that comes up short gives them back to the
+   buddy lists and tries once more. */
+
+/** #Buddy Allocator 한 블록의 최대 order. 2^BUDDY_MAX_ORDER 페이지(4 MB) */
+#define BUDDY_MAX_ORDER 10
+#define BUDDY_NONE UINT32_MAX
+
+/** #Zeroed Pages idle 쓰레드가 pool마다 미리 0으로 채워 두는 페이지 수.
+ *  free 페이지가 이보다 적으면 더 채우지 않는다. */
+#define ZERO_POOL_TARGET 64
+
+/** #Buddy Allocator free 블록 첫 페이지의 free 리스트 연결 (pool 안의 페이지 번호) */
+struct buddy_link {
+    uint32_t prev;
+    uint32_t next;
+};
 
 /* A memory pool. */
 struct pool {
-    struct lock lock;        /* Mutual exclusion. */
     struct bitmap *used_map; /* Bitmap of free pages. */
     uint8_t *base;           /* Base of pool. */
+
+    /** #Buddy Allocator */
+    uint32_t free_head[BUDDY_MAX_ORDER + 1]; /* order별 free 블록 리스트의 첫 페이지 */
+    struct buddy_link *links;                /* 페이지별 free 리스트 연결 */
+    uint8_t *free_order;                     /* free 블록의 첫 페이지면 order + 1, 아니면 0 */
+    size_t free_cnt;                         /* free 페이지 수 */
+
+    /** #Zeroed Pages */
+    uint32_t zero_head;                      /* 0으로 채운 페이지 stack. links[].next로 잇는다 */
+    size_t zero_cnt;                         /* stack의 페이지 수 */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -43,6 +88,13 @@ size_t user_page_limit = SIZE_MAX;
 static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool(const struct pool *, void *page);
+static size_t pool_alloc(struct pool *, size_t page_cnt);
+static size_t pool_alloc_aligned(struct pool *, size_t page_cnt);
+static void pool_free_range(struct pool *, size_t page_idx, size_t page_cnt);
+static void pool_take_range(struct pool *, size_t page_idx, size_t page_cnt);
+static size_t zero_pop(struct pool *);
+static bool zero_drain(struct pool *);
+static bool zero_refill(struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -218,12 +270,12 @@ static void populate_pools(struct area *base_mem, struct area *ext_mem) {
             page_idx = pg_no(start) - pg_no(pool->base);
             if ((uint64_t)pool_end < end) {
                 page_cnt = ((uint64_t)pool_end - start) / PGSIZE;
-                bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+                pool_free_range(pool, page_idx, page_cnt);
                 start = (uint64_t)pool_end;
                 goto split;
             } else {
                 page_cnt = ((uint64_t)end - start) / PGSIZE;
-                bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+                pool_free_range(pool, page_idx, page_cnt);
             }
         }
     }
@@ -253,10 +305,25 @@ uint64_t palloc_init(void) {
    FLAGS, in which case the kernel panics. */
 void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    enum intr_level old_level;
+    bool zeroed = false;
+    size_t page_idx;
 
-    lock_acquire(&pool->lock);
-    size_t page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-    lock_release(&pool->lock);
+    /** #Buddy Allocator O(log n)이므로 interrupt를 끄는 것만으로 보호한다.
+     *  덕분에 do_schedule()처럼 block할 수 없는 곳에서도 free할 수 있다. */
+    old_level = intr_disable();
+    /** #Zeroed Pages 한 페이지짜리 PAL_ZERO 요청은 미리 0으로 채운 페이지를 먼저 쓴다 */
+    if (page_cnt == 1 && (flags & PAL_ZERO) && pool->zero_head != BUDDY_NONE) {
+        page_idx = zero_pop(pool);
+        zeroed = true;
+    } else {
+        page_idx = pool_alloc(pool, page_cnt);
+        /* 미리 채운 페이지 때문에 모자라면 buddy에 돌려주고 다시 시도한다.
+         * 2^BUDDY_MAX_ORDER 페이지보다 커서 used_map을 훑는 요청도 마찬가지다 */
+        if (page_idx == BITMAP_ERROR && zero_drain(pool))
+            page_idx = pool_alloc(pool, page_cnt);
+    }
+    intr_set_level(old_level);
     void *pages;
 
     if (page_idx != BITMAP_ERROR)
@@ -265,7 +332,7 @@ void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
         pages = NULL;
 
     if (pages) {
-        if (flags & PAL_ZERO)
+        if ((flags & PAL_ZERO) && !zeroed)
             memset(pages, 0, PGSIZE * page_cnt);
     } else {
         if (flags & PAL_ASSERT)
@@ -275,6 +342,33 @@ void *palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     return pages;
 }
 
+/** #Huge Page palloc_get_multiple()과 같지만 물리 주소가 PAGE_CNT * PGSIZE의 배수에서 시작하는
+ *  PAGE_CNT 페이지를 준다. PAGE_CNT는 2^BUDDY_MAX_ORDER 이하의 2의 거듭제곱이어야 한다. 큰 페이지 매핑에 쓴다. */
+void *palloc_get_aligned(enum palloc_flags flags, size_t page_cnt) {
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    enum intr_level old_level;
+    size_t page_idx;
+    void *pages = NULL;
+
+    ASSERT(page_cnt > 0 && (page_cnt & (page_cnt - 1)) == 0);
+    ASSERT(page_cnt <= ((size_t)1 << BUDDY_MAX_ORDER));
+
+    old_level = intr_disable();
+    page_idx = pool_alloc_aligned(pool, page_cnt);
+    /** #Zeroed Pages 미리 채운 페이지 때문에 모자라면 buddy에 돌려주고 다시 시도한다 */
+    if (page_idx == BITMAP_ERROR && zero_drain(pool))
+        page_idx = pool_alloc_aligned(pool, page_cnt);
+    intr_set_level(old_level);
+
+    if (page_idx != BITMAP_ERROR)
+        pages = pool->base + PGSIZE * page_idx;
+    if (pages != NULL && (flags & PAL_ZERO))
+        memset(pages, 0, PGSIZE * page_cnt);
+    else if (pages == NULL && (flags & PAL_ASSERT))
+        PANIC("palloc_get: out of pages");
+    return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -290,6 +384,7 @@ void *palloc_get_page(enum palloc_flags flags) {
 void palloc_free_multiple(void *pages, size_t page_cnt) {
     struct pool *pool;
     size_t page_idx;
+    enum intr_level old_level;
 
     ASSERT(pg_ofs(pages) == 0);
     if (pages == NULL || page_cnt == 0)
@@ -307,8 +402,10 @@ void palloc_free_multiple(void *pages, size_t page_cnt) {
 #ifndef NDEBUG
     memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
+    old_level = intr_disable();
     ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-    bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+    pool_free_range(pool, page_idx, page_cnt);
+    intr_set_level(old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -316,6 +413,30 @@ void palloc_free_page(void *page) {
     palloc_free_multiple(page, 1);
 }
 
+/** #Page Reclaim FLAGS가 고르는 pool(PAL_USER면 user pool)의 free 페이지 수.
+ *  락 없이 읽으므로 근사값이다. */
+size_t palloc_free_cnt(enum palloc_flags flags) {
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+    return pool->free_cnt + pool->zero_cnt;
+}
+
+/** #Zeroed Pages 0으로 채운 페이지가 모자란 pool에서 free 페이지 하나를 가져와 0으로 채워 둔다.
+ *  채운 페이지가 있으면 true이다. idle 쓰레드는 한 번에 한 페이지씩 부르고 그 사이 run queue를 본다.
+ *  0으로 채우는 동안에는 interrupt를 켜 두므로 그 사이 다른 쓰레드가 선점할 수 있다. */
+bool palloc_zero_refill(void) {
+    return zero_refill(&kernel_pool) || zero_refill(&user_pool);
+}
+
+/** #Frame Table FLAGS가 고르는 pool의 첫 페이지 주소를 *BASE에 넣고 pool의 페이지 수를 반환한다.
+ *  pool의 페이지는 모두 [*BASE, *BASE + 반환값 * PGSIZE) 안에 있다. */
+size_t palloc_pool_range(enum palloc_flags flags, void **base) {
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+    *base = pool->base;
+    return bitmap_size(pool->used_map);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
     /* We'll put the pool's used_map at its base.
@@ -323,8 +444,10 @@ static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t e
        and subtract it from the pool's size. */
     uint64_t pgcnt = (end - start) / PGSIZE;
     size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(pgcnt), PGSIZE) * PGSIZE;
+    size_t link_pages = DIV_ROUND_UP(pgcnt * sizeof(struct buddy_link), PGSIZE) * PGSIZE;
+    size_t order_pages = DIV_ROUND_UP(pgcnt, PGSIZE) * PGSIZE;
+    int order;
 
-    lock_init(&p->lock);
     p->used_map = bitmap_create_in_buf(pgcnt, *bm_base, bm_pages);
     p->base = (void *)start;
 
@@ -332,6 +455,219 @@ static void init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t e
     bitmap_set_all(p->used_map, true);
 
     *bm_base += bm_pages;
+
+    /** #Buddy Allocator free 블록은 populate_pools()가 pool_free_range()로 채운다 */
+    for (order = 0; order <= BUDDY_MAX_ORDER; order++)
+        p->free_head[order] = BUDDY_NONE;
+    p->links = *bm_base;
+    *bm_base += link_pages;
+    p->free_order = *bm_base;
+    memset(p->free_order, 0, pgcnt);
+    *bm_base += order_pages;
+
+    p->zero_head = BUDDY_NONE;
+    p->zero_cnt = 0;
+}
+
+/** #Buddy Allocator IDX에서 시작하는 order ORDER 블록을 free 리스트에 넣는다 */
+static void block_push(struct pool *p, size_t idx, int order) {
+    uint32_t head = p->free_head[order];
+
+    p->free_order[idx] = order + 1;
+    p->links[idx].prev = BUDDY_NONE;
+    p->links[idx].next = head;
+    if (head != BUDDY_NONE)
+        p->links[head].prev = idx;
+    p->free_head[order] = idx;
+}
+
+/** #Buddy Allocator IDX에서 시작하는 order ORDER 블록을 free 리스트에서 뺀다 */
+static void block_remove(struct pool *p, size_t idx, int order) {
+    struct buddy_link *link = &p->links[idx];
+
+    ASSERT(p->free_order[idx] == order + 1);
+    p->free_order[idx] = 0;
+    if (link->prev != BUDDY_NONE)
+        p->links[link->prev].next = link->next;
+    else
+        p->free_head[order] = link->next;
+    if (link->next != BUDDY_NONE)
+        p->links[link->next].prev = link->prev;
+}
+
+/** #Buddy Allocator PAGE_CNT 페이지를 담는 가장 작은 order */
+static int buddy_order(size_t page_cnt) {
+    int order = 0;
+
+    while (((size_t)1 << order) < page_cnt)
+        order++;
+    return order;
+}
+
+/** #Buddy Allocator IDX에서 시작하는 order ORDER 블록을 free로 만들고, buddy도 free인 동안 합친다 */
+static void buddy_free(struct pool *p, size_t idx, int order) {
+    size_t pgcnt = bitmap_size(p->used_map);
+
+    while (order < BUDDY_MAX_ORDER) {
+        size_t buddy = idx ^ ((size_t)1 << order);
+
+        if (buddy + ((size_t)1 << order) > pgcnt || p->free_order[buddy] != order + 1)
+            break;
+        block_remove(p, buddy, order);
+        if (buddy < idx)
+            idx = buddy;
+        order++;
+    }
+    block_push(p, idx, order);
+}
+
+/** #Buddy Allocator P의 PAGE_IDX부터 PAGE_CNT 페이지를 free로 만든다.
+ *  범위를 정렬된 2의 거듭제곱 블록들로 나누어 하나씩 buddy_free()한다. */
+static void pool_free_range(struct pool *p, size_t page_idx, size_t page_cnt) {
+    bitmap_set_multiple(p->used_map, page_idx, page_cnt, false);
+    p->free_cnt += page_cnt;
+
+    while (page_cnt > 0) {
+        int order = 0;
+
+        while (order < BUDDY_MAX_ORDER && page_idx % ((size_t)2 << order) == 0 &&
+               ((size_t)2 << order) <= page_cnt)
+            order++;
+        buddy_free(p, page_idx, order);
+        page_idx += (size_t)1 << order;
+        page_cnt -= (size_t)1 << order;
+    }
+}
+
+/** #Buddy Allocator free인 PAGE_IDX부터 PAGE_CNT 페이지를 할당한다.
+ *  범위에 걸친 free 블록을 빼고, 범위 밖으로 남는 부분은 다시 free로 돌려준다. */
+static void pool_take_range(struct pool *p, size_t page_idx, size_t page_cnt) {
+    size_t end = page_idx + page_cnt;
+    size_t i = page_idx;
+
+    while (i < end) {
+        size_t head = i;
+        int order;
+
+        /* I를 포함하는 free 블록을 찾는다 */
+        for (order = 0; order <= BUDDY_MAX_ORDER; order++) {
+            head = i & ~(((size_t)1 << order) - 1);
+            if (p->free_order[head] == order + 1)
+                break;
+        }
+        ASSERT(order <= BUDDY_MAX_ORDER);
+
+        size_t block_end = head + ((size_t)1 << order);
+        block_remove(p, head, order);
+        p->free_cnt -= (size_t)1 << order;
+        if (head < page_idx)
+            pool_free_range(p, head, page_idx - head);
+        if (block_end > end)
+            pool_free_range(p, end, block_end - end);
+        i = block_end;
+    }
+    bitmap_set_multiple(p->used_map, page_idx, page_cnt, true);
+}
+
+/** #Buddy Allocator P에서 연속된 PAGE_CNT 페이지를 할당하고 첫 페이지 번호를 반환한다.
+ *  없으면 BITMAP_ERROR. 2^BUDDY_MAX_ORDER 페이지보다 큰 요청은 used_map을 훑는다. */
+static size_t pool_alloc(struct pool *p, size_t page_cnt) {
+    int want = buddy_order(page_cnt);
+    int order;
+    size_t idx;
+
+    if (want > BUDDY_MAX_ORDER) {
+        idx = bitmap_scan(p->used_map, 0, page_cnt, false);
+        if (idx != BITMAP_ERROR)
+            pool_take_range(p, idx, page_cnt);
+        return idx;
+    }
+
+    for (order = want; order <= BUDDY_MAX_ORDER; order++)
+        if (p->free_head[order] != BUDDY_NONE)
+            break;
+    if (order > BUDDY_MAX_ORDER)
+        return BITMAP_ERROR;
+
+    idx = p->free_head[order];
+    block_remove(p, idx, order);
+
+    /* 남는 위쪽 절반을 한 order씩 내려가며 돌려준다 */
+    while (order > want) {
+        order--;
+        block_push(p, idx + ((size_t)1 << order), order);
+    }
+
+    p->free_cnt -= (size_t)1 << want;
+
+    /* 2의 거듭제곱이 아닌 요청은 꼬리를 돌려준다 */
+    if (page_cnt < ((size_t)1 << want))
+        pool_free_range(p, idx + page_cnt, ((size_t)1 << want) - page_cnt);
+
+    bitmap_set_multiple(p->used_map, idx, page_cnt, true);
+    return idx;
+}
+
+/** #Huge Page 물리 주소가 PAGE_CNT 페이지 경계에 맞는 PAGE_CNT 페이지를 buddy free 리스트에서 할당한다.
+ *  pool의 시작이 그 경계에 맞으면 buddy 블록이 그대로 맞고, 아니면 한 order 이상 큰 free 블록에서
+ *  경계에 맞는 부분을 잘라 쓰고 나머지는 돌려준다. 없으면 BITMAP_ERROR. */
+static size_t pool_alloc_aligned(struct pool *p, size_t page_cnt) {
+    /* 물리 주소가 경계에 맞는 첫 pool 페이지 번호. 모든 order >= want 블록은 이만큼 밀린다 */
+    size_t skew = (page_cnt - pg_no(vtop(p->base)) % page_cnt) % page_cnt;
+    int order;
+
+    if (skew == 0)
+        return pool_alloc(p, page_cnt);
+
+    for (order = buddy_order(page_cnt) + 1; order <= BUDDY_MAX_ORDER; order++)
+        if (p->free_head[order] != BUDDY_NONE) {
+            size_t idx = p->free_head[order] + skew;
+
+            pool_take_range(p, idx, page_cnt);
+            return idx;
+        }
+    return BITMAP_ERROR;
+}
+
+/** #Zeroed Pages P의 0으로 채운 페이지 stack에서 하나를 꺼낸다. stack이 비어 있으면 안 된다 */
+static size_t zero_pop(struct pool *p) {
+    size_t idx = p->zero_head;
+
+    ASSERT(idx != BUDDY_NONE);
+    p->zero_head = p->links[idx].next;
+    p->zero_cnt--;
+    return idx;
+}
+
+/** #Zeroed Pages P의 0으로 채운 페이지를 모두 buddy에 돌려준다. 돌려준 페이지가 있으면 true */
+static bool zero_drain(struct pool *p) {
+    bool drained = p->zero_head != BUDDY_NONE;
+
+    while (p->zero_head != BUDDY_NONE)
+        pool_free_range(p, zero_pop(p), 1);
+    return drained;
+}
+
+/** #Zeroed Pages palloc_zero_refill()의 pool 하나 몫 */
+static bool zero_refill(struct pool *p) {
+    enum intr_level old_level;
+    size_t idx = BITMAP_ERROR;
+
+    old_level = intr_disable();
+    if (p->zero_cnt < ZERO_POOL_TARGET && p->free_cnt > ZERO_POOL_TARGET)
+        idx = pool_alloc(p, 1);
+    intr_set_level(old_level);
+    if (idx == BITMAP_ERROR)
+        return false;
+
+    memset(p->base + PGSIZE * idx, 0, PGSIZE);
+
+    old_level = intr_disable();
+    p->links[idx].next = p->zero_head;
+    p->zero_head = idx;
+    p->zero_cnt++;
+    intr_set_level(old_level);
+    return true;
 }
 
 /* Returns true if PAGE was allocated from POOL,
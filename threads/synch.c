@@ -32,8 +32,17 @@
 #include <string.h>
 
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
+static void lock_take(struct lock *lock, struct thread *t);
+static bool sema_waiter_less(const struct heap_elem *, const struct heap_elem *, void *aux);
+static struct rwlock_hold *rwlock_find_hold(struct thread *t, const struct rwlock *rw);
+static int sema_max_priority(struct semaphore *sema);
+
+/** #Priority Scheduling - Synchronization sema_down()한 순서. 같은 priority의 waiter는 먼저 온 쪽이 깨어난다 */
+static uint64_t sema_wait_seq;
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -47,7 +56,7 @@ void sema_init(struct semaphore *sema, unsigned value) {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    heap_init(&sema->waiters, sema_waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -59,6 +68,7 @@ void sema_init(struct semaphore *sema, unsigned value) {
    thread will probably turn interrupts back on. This is
    sema_down function. */
 void sema_down(struct semaphore *sema) {
+    struct thread *t = thread_current();
     enum intr_level old_level;
 
     ASSERT(sema != NULL);
@@ -66,9 +76,11 @@ void sema_down(struct semaphore *sema) {
 
     old_level = intr_disable();
     while (sema->value == 0) {
-        /** #Priority Scheduling - Synchronization sema_priority 순서대로 waiters에 삽입  */
-        list_insert_ordered(&sema->waiters, &thread_current()->elem, cmp_priority, NULL);
-        // list_push_back(&sema->waiters, &thread_current()->elem);
+        /** #Priority Scheduling - Synchronization priority 순서로 꺼낼 수 있도록 waiters heap에 삽입.
+         *  기다리는 동안 priority가 바뀌면 thread_change_priority()가 위치를 다시 잡는다. */
+        t->blocked_sema = sema;
+        t->wait_seq = sema_wait_seq++;
+        heap_insert(&sema->waiters, &t->wait_elem);
         thread_block();
     }
     sema->value--;
@@ -107,10 +119,14 @@ void sema_up(struct semaphore *sema) {
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
-    if (!list_empty(&sema->waiters)) {
-        /** #Priority Scheduling - Synchronization waiter list 정렬 */
-        list_sort(&sema->waiters, cmp_priority, NULL);
-        thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
+    if (!heap_empty(&sema->waiters)) {
+        /** #Project 1: Advanced Scheduler 잠든 동안 바뀐 waiter들의 priority로 고른다 */
+        if (thread_mlfqs)
+            mlfqs_update_waiters(&sema->waiters);
+        /** #Priority Scheduling - Synchronization priority가 가장 높은 waiter를 깨운다 */
+        struct thread *t = heap_entry(heap_pop_min(&sema->waiters), struct thread, wait_elem);
+        t->blocked_sema = NULL;
+        thread_unblock(t);
     }
     sema->value++;
     test_max_priority();
@@ -168,6 +184,7 @@ void lock_init(struct lock *lock) {
 
     lock->holder = NULL;
     sema_init(&lock->semaphore, 1);
+    lock->priority = PRI_MIN - 1;
 }
 
 /* LOCK을 획득하고 필요한 경우 사용할 수 있을 때까지 절전 모드로 유지됩니다.
@@ -181,11 +198,15 @@ void lock_acquire(struct lock *lock) {
     ASSERT(!intr_context());
     ASSERT(!lock_held_by_current_thread(lock));
 
-    /** #Priority Donation & Advanced Scheduler mlfqs 스케줄러 비활성화시 wait를 하게 될 lock 포인터 저장 후 대기 리스트에 추가하고 priority donation 수행 */
     thread_t *t = thread_current();
+    /* holder를 읽고 정하는 사이에 선점되지 않도록 인터럽트를 끈다 */
+    enum intr_level old_level = intr_disable();
+
+    /** #Priority Donation & Advanced Scheduler mlfqs 스케줄러 비활성화시 wait를 하게 될 lock 포인터 저장 후 priority donation 수행
+     *  CPU가 하나뿐이라 holder는 이 쓰레드가 도는 동안 실행 중일 수 없다. spin해도 holder가 lock을
+     *  놓을 기회가 없으므로 spin 단계 없이 바로 block하고, 대신 priority를 기부해 holder를 먼저 돌린다. */
     if (lock->holder != NULL) {
         t->wait_lock = lock;
-        list_push_back(&lock->holder->donations, &t->donation_elem);
         if (!thread_mlfqs)
             donate_priority();
     }
@@ -194,7 +215,22 @@ void lock_acquire(struct lock *lock) {
 
     /** #Priority Donation 기다리고 있던 lock 포인터 반환 후 holder 갱신 */
     t->wait_lock = NULL;
+    lock_take(lock, t);
+    intr_set_level(old_level);
+}
+
+/** #Priority Donation T를 LOCK의 holder로 정하고 held_locks에 넣는다.
+ *  아직 LOCK을 기다리는 쓰레드들의 priority는 이제 T에게 기부된다. */
+static void lock_take(struct lock *lock, struct thread *t) {
+    enum intr_level old_level = intr_disable();
+
     lock->holder = t;
+    lock->priority = sema_max_priority(&lock->semaphore);
+    heap_insert(&t->held_locks, &lock->held_elem);
+
+    if (!thread_mlfqs && t->priority < lock->priority)
+        t->priority = lock->priority;
+    intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -204,14 +240,18 @@ void lock_acquire(struct lock *lock) {
    This function will not sleep, so it may be called within an
    interrupt handler. */
 bool lock_try_acquire(struct lock *lock) {
+    enum intr_level old_level;
     bool success;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    /* semaphore를 내린 뒤 holder를 정하기 전에 선점되지 않도록 한다 */
+    old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
     if (success)
-        lock->holder = thread_current();
+        lock_take(lock, thread_current());
+    intr_set_level(old_level);
     return success;
 }
 
@@ -219,18 +259,22 @@ bool lock_try_acquire(struct lock *lock) {
    인터럽트 핸들러는 잠금을 획득할 수 없으므로 인터럽트 핸들러 내에서 잠금을
    해제하는 것은 의미가 없습니다. */
 void lock_release(struct lock *lock) {
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     lock->holder = NULL;
+    heap_remove(&thread_current()->held_locks, &lock->held_elem);
+    lock->priority = PRI_MIN - 1;
 
-    /** #Priority Donation & Advanced Scheduler mlfqs 스케줄러 비활성화시 현재 쓰레드 대기 리스트 및 priority 갱신  */
-    if (!thread_mlfqs) {
-        remove_with_lock(lock);
+    /** #Priority Donation & Advanced Scheduler mlfqs 스케줄러 비활성화시 현재 쓰레드 priority 갱신  */
+    if (!thread_mlfqs)
         refresh_priority();
-    }
 
     sema_up(&lock->semaphore);
+    intr_set_level(old_level);
 }
 
 /* 현재 스레드가 LOCK을 보유하고 있으면 true를 반환하고, 그렇지 않으면 false를 반환합니다.
@@ -285,8 +329,8 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
 
     sema_init(&waiter.semaphore, 0);
-    /** #Priority Scheduling - Synchronization sema_priority 순서대로 waiters에 삽입  */
-    list_insert_ordered(&cond->waiters, &waiter.elem, cmp_sem_priority, NULL);
+    /** #Priority Scheduling - Synchronization 깨울 때 priority를 비교하므로 순서대로 삽입 */
+    list_push_back(&cond->waiters, &waiter.elem);
     lock_release(lock);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
@@ -306,9 +350,26 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
     ASSERT(lock_held_by_current_thread(lock));
 
     if (!list_empty(&cond->waiters)) {
-        /** #Priority Scheduling - Synchronization sema_priority 순서대로 재정렬  */
-        list_sort(&cond->waiters, cmp_sem_priority, NULL);
-        sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+        /** #Priority Scheduling - Synchronization priority가 가장 높은 waiter를 찾는다. 같으면 먼저 기다린 쪽 */
+        struct semaphore_elem *max = NULL;
+        int max_priority = PRI_MIN - 1;
+        struct list_elem *e;
+
+        for (e = list_begin(&cond->waiters); e != list_end(&cond->waiters); e = list_next(e)) {
+            struct semaphore_elem *waiter = list_entry(e, struct semaphore_elem, elem);
+            int priority;
+
+            if (thread_mlfqs)
+                mlfqs_update_waiters(&waiter->semaphore.waiters);
+            priority = sema_max_priority(&waiter->semaphore);
+
+            if (max == NULL || priority > max_priority) {
+                max = waiter;
+                max_priority = priority;
+            }
+        }
+        list_remove(&max->elem);
+        sema_up(&max->semaphore);
     }
 }
 
@@ -326,25 +387,146 @@ void cond_broadcast(struct condition *cond, struct lock *lock) {
         cond_signal(cond, lock);
 }
 
-/** #Priority Scheduling - Synchronization 첫 번째 인자의 우선순위가 두 번째 인자의 우선순위보다 높으면 1, 아니면 0을 반환 */
-bool cmp_sem_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
-    struct semaphore_elem *sema_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *sema_b = list_entry(b, struct semaphore_elem, elem);
+/** #Reader-Writer Lock RW 초기화 */
+void rwlock_init(struct rwlock *rw) {
+    ASSERT(rw != NULL);
 
-    if (sema_a == NULL || sema_b == NULL)
-        return false;
+    lock_init(&rw->write_lock);
+    list_init(&rw->readers);
+    rw->pending_writer = NULL;
+    sema_init(&rw->readers_done, 0);
+}
+
+/** #Reader-Writer Lock RW를 read로 획득. writer가 보유하거나 기다리고 있으면 block된다.
+   같은 쓰레드가 이미 read로 보유한 RW를 다시 획득하면 안 된다.
+   동시에 read로 보유하는 rwlock 수에는 제한이 없다. RWLOCK_READ_INLINE개를 넘는
+   기록은 malloc()하며, 그마저 실패하면 kernel panic이다. */
+void rwlock_read_acquire(struct rwlock *rw) {
+    thread_t *t = thread_current();
+    struct rwlock_hold *hold = NULL;
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!lock_held_by_current_thread(&rw->write_lock));
+    ASSERT(rwlock_find_hold(t, rw) == NULL);
+
+    for (int i = 0; i < RWLOCK_READ_INLINE && hold == NULL; i++)
+        if (t->read_hold_slots[i].rwlock == NULL)
+            hold = &t->read_hold_slots[i];
+    if (hold == NULL) {
+        hold = malloc(sizeof *hold);
+        if (hold == NULL)
+            PANIC("rwlock_read_acquire: out of memory");
+    }
+
+    /* writer가 있으면 여기서 block하며 lock_acquire()의 donation으로 writer에게 기부 */
+    lock_acquire(&rw->write_lock);
 
-    struct list *list_a = &(sema_a->semaphore.waiters);
-    struct list *list_b = &(sema_b->semaphore.waiters);
+    old_level = intr_disable();
+    hold->rwlock = rw;
+    hold->thread = t;
+    list_push_back(&rw->readers, &hold->elem);
+    list_push_back(&t->read_holds, &hold->thread_elem);
+    intr_set_level(old_level);
+
+    lock_release(&rw->write_lock);
+}
 
-    if (list_a == NULL || list_b == NULL)
-        return false;
+/** #Reader-Writer Lock 현재 쓰레드가 read로 보유한 RW 해제.
+   마지막 reader라면 기다리는 writer를 깨운다. */
+void rwlock_read_release(struct rwlock *rw) {
+    thread_t *t = thread_current();
+    struct rwlock_hold *hold = rwlock_find_hold(t, rw);
+    enum intr_level old_level;
 
-    thread_t *thread_a = list_entry(list_begin(list_a), thread_t, elem);
-    thread_t *thread_b = list_entry(list_begin(list_b), thread_t, elem);
+    ASSERT(rw != NULL);
+    ASSERT(hold != NULL);
+
+    old_level = intr_disable();
+    list_remove(&hold->elem);
+    list_remove(&hold->thread_elem);
+    hold->rwlock = NULL;
+
+    /* writer에게 기부받은 priority 회수 */
+    if (!thread_mlfqs)
+        refresh_priority();
+
+    if (list_empty(&rw->readers) && rw->pending_writer != NULL)
+        sema_up(&rw->readers_done);
+    else
+        test_max_priority();
+    intr_set_level(old_level);
+
+    if (hold < t->read_hold_slots || hold >= t->read_hold_slots + RWLOCK_READ_INLINE)
+        free(hold);
+}
+
+/** #Reader-Writer Lock T가 RW를 read로 보유한 기록. 보유하지 않으면 NULL */
+static struct rwlock_hold *rwlock_find_hold(struct thread *t, const struct rwlock *rw) {
+    struct list_elem *e;
+
+    for (e = list_begin(&t->read_holds); e != list_end(&t->read_holds); e = list_next(e)) {
+        struct rwlock_hold *hold = list_entry(e, struct rwlock_hold, thread_elem);
+        if (hold->rwlock == rw)
+            return hold;
+    }
+    return NULL;
+}
+
+/** #Reader-Writer Lock RW를 write로 획득. 다른 writer가 끝나고 모든 reader가 나갈 때까지
+   block되며, 기다리는 동안 reader들에게 priority를 기부한다. */
+void rwlock_write_acquire(struct rwlock *rw) {
+    thread_t *t = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    lock_acquire(&rw->write_lock);
+
+    old_level = intr_disable();
+    while (!list_empty(&rw->readers)) {
+        rw->pending_writer = t;
+        t->wait_rwlock = rw;
+        if (!thread_mlfqs)
+            donate_priority();
+        sema_down(&rw->readers_done);
+    }
+    rw->pending_writer = NULL;
+    t->wait_rwlock = NULL;
+    intr_set_level(old_level);
+}
+
+/** #Reader-Writer Lock 현재 쓰레드가 write로 보유한 RW 해제 */
+void rwlock_write_release(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    lock_release(&rw->write_lock);
+}
+
+/** #Reader-Writer Lock 현재 쓰레드가 RW를 write로 보유하고 있으면 true */
+bool rwlock_held_by_current_thread(const struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    return lock_held_by_current_thread(&rw->write_lock);
+}
+
+/** #Priority Scheduling - Synchronization waiters heap 비교 함수. priority가 높은 쓰레드가 앞서고,
+ *  같으면 먼저 기다린 쓰레드가 앞선다. */
+static bool sema_waiter_less(const struct heap_elem *a_, const struct heap_elem *b_, void *aux UNUSED) {
+    const struct thread *a = heap_entry(a_, struct thread, wait_elem);
+    const struct thread *b = heap_entry(b_, struct thread, wait_elem);
+
+    if (a->priority != b->priority)
+        return a->priority > b->priority;
+    return a->wait_seq < b->wait_seq;
+}
 
-    if (thread_a == NULL || thread_b == NULL)
-        return false;
+/** #Priority Scheduling - Synchronization SEMA를 기다리는 쓰레드 중 가장 높은 priority. 없으면 PRI_MIN - 1 */
+static int sema_max_priority(struct semaphore *sema) {
+    if (heap_empty(&sema->waiters))
+        return PRI_MIN - 1;
 
-    return thread_a->priority > thread_b->priority;
+    return heap_entry(heap_min(&sema->waiters), struct thread, wait_elem)->priority;
 }
\ No newline at end of file
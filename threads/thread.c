@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "devices/timer.h"
 #include "intrinsic.h"
 #include "threads/fixed_point.h"
 #include "threads/flags.h"
@@ -27,26 +28,26 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/** #Project 1: Alarm Clock 전역 변수 */
-static struct list sleep_list;
+/** #Project 1: Alarm Clock 전역 변수
+ *  wakeup_tick 기준 min-heap. 깨울 쓰레드 N개를 처리하는 비용이 전체 sleep 쓰레드 수와 무관하다. */
+static struct heap sleep_heap;
 static int64_t next_tick_to_awake;
 
+static bool cmp_wakeup_tick(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED);
+
 /* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+   that are ready to run but not actually running.
 
-/** #Project 1: Advanced Scheduler */
-static struct list all_list;
+   #Project 1: Priority Scheduling 우선순위(PRI_MIN..PRI_MAX)마다 FIFO 큐를 하나씩 두고,
+   비어있지 않은 큐를 ready_bitmap의 비트로 표시한다. 삽입은 O(1), 최고 우선순위
+   탐색은 find-first-set 한 번으로 끝난다. */
+static struct list ready_queue[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt; /* READY 상태 쓰레드 수 (load_avg 계산용) */
 
 /* Idle thread. */
 static struct thread *idle_thread;
 
-/* Initial thread, the thread running init.c:main(). */
-static struct thread *initial_thread;
-
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
-
 /* Thread destruction requests */
 static struct list destruction_req;
 
@@ -55,6 +56,23 @@ static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
 
+/** #Project 1: Advanced Scheduler 1초마다 적용되는 recent_cpu decay 계수 기록.
+ *  BLOCKED 쓰레드는 다음에 깨어날 때 밀린 decay를 한꺼번에 적용한다.
+ *  기록이 DECAY_HISTORY초 분량뿐이므로, 그보다 오래 잠든 쓰레드는 필요한 계수가 지워지기
+ *  직전에 mlfqs_recalc_recent_cpu()가 따라잡아 준다. BLOCKED 쓰레드는 recent_cpu_epoch %
+ *  DECAY_HISTORY 번째 decay_waiters 리스트에 있으므로, 1초마다 리스트 하나만 훑으면 된다.
+ *  매초 갱신과 같은 계수를 같은 순서로 적용하므로 결과는 매초 갱신한 값과 정확히 같다. */
+#define DECAY_HISTORY 64
+static int decay_coeff[DECAY_HISTORY]; /* decay_coeff[e % DECAY_HISTORY]: e번째 decay 계수 */
+static int64_t decay_epoch;            /* 지금까지 지난 decay 횟수 (초) */
+static struct list decay_waiters[DECAY_HISTORY];
+
+/* Initial thread, the thread running init.c:main(). */
+static struct thread *initial_thread;
+
+/* Lock used by allocate_tid(). */
+static struct lock tid_lock;
+
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
 static unsigned thread_ticks; /* # of timer ticks since last yield. */
@@ -76,6 +94,15 @@ static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
 
+static void ready_queue_push(struct thread *);
+static void ready_queue_remove(struct thread *);
+static struct thread *ready_queue_pop(void);
+static int ready_queue_max_priority(void);
+static void thread_change_priority(struct thread *, int priority);
+static void donate_priority_readers(struct rwlock *, int priority);
+static bool cmp_lock_priority(const struct heap_elem *, const struct heap_elem *, void *aux);
+static int mlfqs_calc_priority(struct thread *);
+
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
@@ -86,6 +113,9 @@ static tid_t allocate_tid(void);
  * somewhere in the middle, this locates the curent thread. */
 #define running_thread() ((struct thread *)(pg_round_down(rrsp())))
 
+/** #Project 1: Advanced Scheduler T가 idle 쓰레드이면 true */
+#define is_idle_thread(t) ((t) == idle_thread)
+
 // Global descriptor table for the thread_start.
 // Because the gdt will be setup after the thread_init, we should
 // setup temporal gdt first.
@@ -112,19 +142,24 @@ void thread_init(void) {
 
     /* Init the globla thread context */
     lock_init(&tid_lock);
-    list_init(&ready_list);
+    for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+        list_init(&ready_queue[pri]);
+    ready_bitmap = 0;
+    ready_cnt = 0;
     list_init(&destruction_req);
 
-    /** #Project 1: Alarm Clock sleep list 초기화 */
-    list_init(&sleep_list);
+    /** #Project 1: Alarm Clock sleep heap 초기화 */
+    heap_init(&sleep_heap, cmp_wakeup_tick, NULL);
+    next_tick_to_awake = INT64_MAX;
 
-    /** #Project 1: Advanced Scheduler all list 초기화 */
-    list_init(&all_list);
+    /** #Project 1: Advanced Scheduler decay 기록 초기화 */
+    decay_epoch = 0;
+    for (int i = 0; i < DECAY_HISTORY; i++)
+        list_init(&decay_waiters[i]);
 
     /* Set up a thread structure for the running thread. */
     initial_thread = running_thread();
     init_thread(initial_thread, "main", PRI_DEFAULT);
-
     initial_thread->status = THREAD_RUNNING;
     initial_thread->tid = allocate_tid();
 }
@@ -167,6 +202,11 @@ void thread_tick(void) {
         intr_yield_on_return();
 }
 
+/** #Tickless Idle one-shot 동안 건너뛴 TICKS를 idle 통계에 반영 */
+void thread_tick_idle(int64_t ticks) {
+    idle_ticks += ticks;
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void) {
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", idle_ticks, kernel_ticks, user_ticks);
@@ -248,7 +288,15 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 void thread_block(void) {
     ASSERT(!intr_context());
     ASSERT(intr_get_level() == INTR_OFF);
-    thread_current()->status = THREAD_BLOCKED;
+
+    /** #Project 1: Advanced Scheduler 잠든 동안 밀릴 decay 계수가 지워지기 전에 따라잡을 수 있도록 등록 */
+    struct thread *curr = thread_current();
+    if (thread_mlfqs && !is_idle_thread(curr)) {
+        list_push_back(&decay_waiters[curr->recent_cpu_epoch % DECAY_HISTORY], &curr->decay_elem);
+        curr->decay_waiting = true;
+    }
+
+    curr->status = THREAD_BLOCKED;
     schedule();
 }
 
@@ -268,9 +316,19 @@ void thread_unblock(struct thread *t) {
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
 
-    /** #Project 1: Priority Scheduling 우선순위 순으로 정렬되어 list에 삽입 */
-    list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
-    // list_push_back(&ready_list, &t->elem);
+    /** #Project 1: Advanced Scheduler 잠든 동안 밀린 recent_cpu decay 적용 후 priority 재계산 */
+    if (thread_mlfqs) {
+        /* thread_create()가 처음 깨우는 쓰레드는 decay_waiters에 없다 */
+        if (t->decay_waiting) {
+            list_remove(&t->decay_elem);
+            t->decay_waiting = false;
+        }
+        mlfqs_recent_cpu(t);
+        mlfqs_priority(t);
+    }
+
+    /** #Project 1: Priority Scheduling 우선순위에 해당하는 ready 큐 뒤에 삽입 */
+    ready_queue_push(t);
     t->status = THREAD_READY;
     intr_set_level(old_level);
 }
@@ -309,9 +367,8 @@ void thread_exit(void) {
 #ifdef USERPROG
     process_exit();
 #endif
-    /** #Project 1: Advanced Scheduler 스레드 종료 시 all_list에서 제거 */
-    if (thread_mlfqs)
-        list_remove(&thread_current()->all_elem);
+    /** #Malloc Magazine 이 쓰레드가 캐시하던 block을 descriptor에 돌려준다 */
+    malloc_drain();
 
     /* 상태를 죽어가는 것으로 설정하고 다른 프로세스를 예약
        이 쓰레드는 Schedule_tail()을 호출하는 동안 파괴됨 */
@@ -323,16 +380,11 @@ void thread_exit(void) {
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 void thread_yield(void) {
-    struct thread *curr = thread_current();
     enum intr_level old_level;
 
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    if (curr != idle_thread)
-        /** #Project 1: Priority Scheduling 우선순위 순으로 정렬되어 list에 삽입 */
-        list_insert_ordered(&ready_list, &curr->elem, cmp_priority, NULL);
-    // list_push_back(&ready_list, &curr->elem);
     do_schedule(THREAD_READY);
     intr_set_level(old_level);
 }
@@ -420,6 +472,20 @@ static void idle(void *idle_started_ UNUSED) {
         intr_disable();
         thread_block();
 
+        /** #Zeroed Pages 할 일이 없는 동안 palloc이 줄 페이지를 미리 0으로 채운다.
+         *  한 페이지마다 run queue를 보고, 깨어난 쓰레드가 있으면 hlt하지 않고 바로 넘겨준다. */
+        for (;;) {
+            bool refilled;
+
+            intr_enable();
+            refilled = palloc_zero_refill();
+            intr_disable();
+            if (!refilled || ready_bitmap != 0)
+                break;
+        }
+        if (ready_bitmap != 0)
+            continue;
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the
@@ -432,6 +498,9 @@ static void idle(void *idle_started_ UNUSED) {
 
            See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
            7.11.1 "HLT Instruction". */
+        /** #Tickless Idle 깨울 쓰레드가 없는 동안 주기적 tick을 멈춘다 */
+        if (timer_tickless)
+            timer_nohz_enter(next_tick_to_awake);
         asm volatile("sti; hlt" : : : "memory");
     }
 }
@@ -460,14 +529,14 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     if (thread_mlfqs) {
         /** #Project 1: Advanced Scheduler 자료구조 초기화 */
         mlfqs_priority(t);
-        list_push_back(&all_list, &t->all_elem);
     } else {
         /** #Project 1: Priority Donation 자료구조 초기화 */
         t->priority = priority;
     }
 
     t->wait_lock = NULL;
-    list_init(&t->donations);
+    heap_init(&t->held_locks, cmp_lock_priority, NULL);
+    list_init(&t->read_holds);
 
     t->magic = THREAD_MAGIC;
 
@@ -475,6 +544,7 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     t->original_priority = t->priority;
     t->niceness = NICE_DEFAULT;
     t->recent_cpu = RECENT_CPU_DEFAULT;
+    t->recent_cpu_epoch = decay_epoch;
 
 #ifdef USERPROG
     /** #Project 2: System Call  */
@@ -494,10 +564,76 @@ static void init_thread(struct thread *t, const char *name, int priority) {
    will be in the run queue.)  If the run queue is empty, return
    idle_thread. */
 static struct thread *next_thread_to_run(void) {
-    if (list_empty(&ready_list))
+    if (ready_bitmap == 0)
         return idle_thread;
     else
-        return list_entry(list_pop_front(&ready_list), struct thread, elem);
+        return ready_queue_pop();
+}
+
+/** #Project 1: Priority Scheduling T를 T->priority 큐 맨 뒤에 삽입하고 bitmap 표시 */
+static void ready_queue_push(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+    list_push_back(&ready_queue[t->priority], &t->elem);
+    ready_bitmap |= 1ULL << t->priority;
+    ready_cnt++;
+}
+
+/** #Project 1: Priority Scheduling READY 상태인 T를 큐에서 제거. 큐가 비면 bitmap 비트 해제 */
+static void ready_queue_remove(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_READY);
+
+    list_remove(&t->elem);
+    if (list_empty(&ready_queue[t->priority]))
+        ready_bitmap &= ~(1ULL << t->priority);
+    ready_cnt--;
+}
+
+/** #Project 1: Priority Scheduling 가장 높은 우선순위 큐의 맨 앞 쓰레드를 꺼내 반환 */
+static struct thread *ready_queue_pop(void) {
+    int pri = ready_queue_max_priority();
+    struct thread *t;
+
+    ASSERT(pri >= PRI_MIN);
+
+    t = list_entry(list_pop_front(&ready_queue[pri]), struct thread, elem);
+    if (list_empty(&ready_queue[pri]))
+        ready_bitmap &= ~(1ULL << pri);
+    ready_cnt--;
+
+    return t;
+}
+
+/** #Project 1: Priority Scheduling ready 큐 중 가장 높은 우선순위 반환. 비어있으면 -1 */
+static int ready_queue_max_priority(void) {
+    if (ready_bitmap == 0)
+        return -1;
+
+    return 63 - __builtin_clzll(ready_bitmap);
+}
+
+/** #Project 1: Priority Scheduling T의 우선순위를 변경. READY 상태라면 새 우선순위 큐로 옮긴다. */
+static void thread_change_priority(struct thread *t, int priority) {
+    enum intr_level old_level;
+
+    if (t->priority == priority)
+        return;
+
+    old_level = intr_disable();
+    if (t->status == THREAD_BLOCKED && t->blocked_sema != NULL) {
+        /* semaphore waiters heap에서 위치를 다시 잡는다 */
+        heap_remove(&t->blocked_sema->waiters, &t->wait_elem);
+        t->priority = priority;
+        heap_insert(&t->blocked_sema->waiters, &t->wait_elem);
+    } else if (t->status == THREAD_READY) {
+        ready_queue_remove(t);
+        t->priority = priority;
+        ready_queue_push(t);
+    } else
+        t->priority = priority;
+    intr_set_level(old_level);
 }
 
 /* Use iretq to launch the thread *** 실제로 context switching을 하는 함수 *** */
@@ -608,13 +744,19 @@ static void thread_launch(struct thread *th) {
  * 실행할 다른 스레드를 찾아서 전환합니다.
  * Schedule()에서 printf()를 호출하는 것은 안전하지 않습니다. */
 static void do_schedule(int status) {
+    struct thread *curr = thread_current();
+
     ASSERT(intr_get_level() == INTR_OFF);
-    ASSERT(thread_current()->status == THREAD_RUNNING);
+    ASSERT(curr->status == THREAD_RUNNING);
     while (!list_empty(&destruction_req)) {
         struct thread *victim = list_entry(list_pop_front(&destruction_req), struct thread, elem);
         palloc_free_page(victim);
     }
-    thread_current()->status = status;
+
+    curr->status = status;
+    /** #Project 1: Priority Scheduling 양보한 쓰레드는 우선순위에 해당하는 ready 큐 뒤에 삽입 */
+    if (status == THREAD_READY && curr != idle_thread)
+        ready_queue_push(curr);
     schedule();
 }
 
@@ -625,6 +767,11 @@ static void schedule(void) {
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(curr->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
+
+    /** #Tickless Idle idle 쓰레드가 멈추면 주기적 tick 복구 */
+    if (curr == idle_thread && timer_tickless)
+        timer_nohz_exit();
+
     /* Mark us as running. */
     next->status = THREAD_RUNNING;
 
@@ -670,7 +817,7 @@ static tid_t allocate_tid(void) {
 void thread_sleep(int64_t ticks) {
     thread_t *curr = thread_current();
 
-    if (curr == idle_thread) {  // idle -> stop
+    if (is_idle_thread(curr)) {  // idle -> stop
         ASSERT(0);
     } else {
         enum intr_level old_level;
@@ -678,7 +825,7 @@ void thread_sleep(int64_t ticks) {
 
         update_next_tick_to_awake(curr->wakeup_tick = ticks);  // update awake ticks
 
-        list_push_back(&sleep_list, &curr->elem);  // push to sleep_list
+        heap_insert(&sleep_heap, &curr->sleep_elem);  // push to sleep_heap
 
         thread_block();  // block this thread
 
@@ -689,22 +836,29 @@ void thread_sleep(int64_t ticks) {
 void thread_awake(int64_t wakeup_tick) {
     next_tick_to_awake = INT64_MAX;
 
-    struct list_elem *sleeping = list_begin(&sleep_list);  // take sleeping thread
     thread_t *th;
 
-    while (sleeping != list_end(&sleep_list)) {  // for all sleeping threads
-        th = list_entry(sleeping, thread_t, elem);
+    while (!heap_empty(&sleep_heap)) {  // 깨울 시각이 지난 쓰레드만 꺼낸다
+        th = heap_entry(heap_min(&sleep_heap), thread_t, sleep_elem);
 
-        if (wakeup_tick >= th->wakeup_tick) {
-            sleeping = list_remove(&th->elem);  // delete thread
-            thread_unblock(th);                 // unblock thread
-        } else {
-            update_next_tick_to_awake(th->wakeup_tick);  // update wakeup_tick
-            sleeping = list_next(sleeping);              // move to next sleeping thread
+        if (wakeup_tick < th->wakeup_tick) {
+            update_next_tick_to_awake(th->wakeup_tick);  // 남은 쓰레드 중 가장 이른 wakeup_tick
+            break;
         }
+
+        heap_pop_min(&sleep_heap);  // delete thread
+        thread_unblock(th);         // unblock thread
     }
 }
 
+/** #Project 1: Alarm Clock sleep_heap 비교 함수. wakeup_tick이 이른 쓰레드가 앞선다 */
+static bool cmp_wakeup_tick(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+    thread_t *thread_a = heap_entry(a, thread_t, sleep_elem);
+    thread_t *thread_b = heap_entry(b, thread_t, sleep_elem);
+
+    return thread_a->wakeup_tick < thread_b->wakeup_tick;
+}
+
 /** #Project 1: Alarm Clock 다음 활성화 tick 갱신 함수 */
 void update_next_tick_to_awake(int64_t ticks) {
     next_tick_to_awake = (next_tick_to_awake > ticks) ? ticks : next_tick_to_awake;
@@ -717,12 +871,10 @@ int64_t get_next_tick_to_awake(void) {
 
 /** #Project 1: Priority Scheduling ready_list에서 우선 순위가 가장 높은 쓰레드와 현재 쓰레드의 우선 순위를 비교 */
 void test_max_priority(void) {
-    if (list_empty(&ready_list))
+    if (ready_bitmap == 0)
         return;
 
-    thread_t *th = list_entry(list_front(&ready_list), thread_t, elem);
-
-    if (thread_current()->priority < th->priority) {
+    if (thread_current()->priority < ready_queue_max_priority()) {
         /** Project 2: Panic 방지 */
         if (intr_context())
             intr_yield_on_return();
@@ -743,116 +895,194 @@ bool cmp_priority(const struct list_elem *a, const struct list_elem *b, void *au
 }
 
 /** #Project 1: Priority Donation 현재 쓰레드가 기다리고 있는 lock과 연결된 모든 쓰레드들을 순회하며
- *  현재 쓰레드의 우선순위를 lock을 보유하고 있는 쓰레드에게 기부한다. */
+ *  현재 쓰레드의 우선순위를 lock을 보유하고 있는 쓰레드에게 기부한다.
+ *  lock의 priority가 이미 기부할 값 이상이면 그 너머의 체인도 이미 반영되어 있으므로 멈춘다.
+ *  lock마다 priority가 올라갈 때만 진행하므로 깊이 제한 없이도 (deadlock 순환이 있더라도) 끝난다. */
 void donate_priority() {
     thread_t *t = thread_current();
     int priority = t->priority;
+    enum intr_level old_level = intr_disable();
+
+    for (;;) {
+        struct lock *lock = t->wait_lock;
+
+        /** #Reader-Writer Lock reader가 나가기를 기다리는 writer라면 모든 reader에게 기부 */
+        if (t->wait_rwlock != NULL) {
+            donate_priority_readers(t->wait_rwlock, priority);
+            break;
+        }
 
-    for (int depth = 0; depth < 8; depth++) {
         /* child가 먼저 삭제되면 holder가 NULL이 되는 경우.*/
-        if (t->wait_lock == NULL || t->wait_lock->holder==NULL) 
+        if (lock == NULL || lock->holder == NULL || lock->priority >= priority)
             break;
 
-        t = t->wait_lock->holder;
-        t->priority = priority;
+        t = lock->holder;
+        heap_remove(&t->held_locks, &lock->held_elem);
+        lock->priority = priority;
+        heap_insert(&t->held_locks, &lock->held_elem);
+
+        if (t->priority >= priority)
+            break;
+        thread_change_priority(t, priority);
     }
+    intr_set_level(old_level);
 }
 
-/** #Project 1: Priority Donation 현재 쓰레드의 waiters 리스트를 확인하여 해지할 lock을 보유하고 있는
- *  엔트리를 삭제한다. */
-void remove_with_lock(struct lock *lock) {
-    thread_t *t = thread_current();
-    struct list_elem *curr = list_begin(&t->donations);
-    thread_t *curr_thread = NULL;
+/** #Reader-Writer Lock RW를 read로 보유 중인 쓰레드들의 priority를 PRIORITY 이상으로 올린다.
+   reader는 다른 lock을 기다리고 있을 수 있지만 그 체인까지 따라가지는 않는다. */
+static void donate_priority_readers(struct rwlock *rw, int priority) {
+    struct list_elem *e;
 
-    while (curr != list_end(&t->donations)) {
-        curr_thread = list_entry(curr, thread_t, donation_elem);
-
-        if (curr_thread->wait_lock == lock)
-            list_remove(&curr_thread->donation_elem);
-
-        curr = list_next(curr);
+    for (e = list_begin(&rw->readers); e != list_end(&rw->readers); e = list_next(e)) {
+        thread_t *reader = list_entry(e, struct rwlock_hold, elem)->thread;
+        if (reader->priority < priority)
+            thread_change_priority(reader, priority);
     }
 }
 
+/** #Project 1: Priority Donation held_locks 비교 함수. 기부된 priority가 높은 lock이 앞선다 */
+static bool cmp_lock_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+    return heap_entry(a, struct lock, held_elem)->priority > heap_entry(b, struct lock, held_elem)->priority;
+}
+
 /** #Project 1: Priority Donation 쓰레드의 우선순위가 변경되었을 때, donation을 고려하여 우선순위를
  *  다시 결정하는 함수 */
 void refresh_priority(void) {
     /* 현재 쓰레드의 우선순위를 기부 받기 전의 우선순위로 변경.
-    현재 쓰레드의 waiters 리스트에서 가장 높은 우선순위를 현재 쓰레드의 우선순위와 비교 후 우선순위 결정 */
+    보유 중인 lock 중 가장 높은 priority를 기부받은 lock과 비교 후 우선순위 결정 */
     thread_t *t = thread_current();
     t->priority = t->original_priority;
 
-    if (list_empty(&t->donations))
-        return;
+    /** #Reader-Writer Lock read로 보유 중인 rwlock을 기다리는 writer의 priority 반영 */
+    for (struct list_elem *e = list_begin(&t->read_holds); e != list_end(&t->read_holds); e = list_next(e)) {
+        struct rwlock *rw = list_entry(e, struct rwlock_hold, thread_elem)->rwlock;
+        if (rw->pending_writer != NULL && t->priority < rw->pending_writer->priority)
+            t->priority = rw->pending_writer->priority;
+    }
 
-    list_sort(&t->donations, cmp_priority, NULL);
+    if (heap_empty(&t->held_locks))
+        return;
 
-    struct list_elem *max_elem = list_front(&t->donations);
-    thread_t *max_thread = list_entry(max_elem, thread_t, donation_elem);
+    struct lock *max_lock = heap_entry(heap_min(&t->held_locks), struct lock, held_elem);
 
-    if (t->priority < max_thread->priority)
-        t->priority = max_thread->priority;
+    if (t->priority < max_lock->priority)
+        t->priority = max_lock->priority;
 }
 
 /** #Project 1: Advanced Scheduler MLFQS Priority 계산하는 함수*/
 void mlfqs_priority(struct thread *t) {
-    if (t == idle_thread)
+    if (is_idle_thread(t))
         return;
 
-    t->priority = fp_to_int(add_mixed(div_mixed(t->recent_cpu, -4), PRI_MAX - t->niceness * 2));
+    thread_change_priority(t, mlfqs_calc_priority(t));
 }
 
-/** #Project 1: Advanced Scheduler MLFQS Recent Cpu 계산하는 함수 */
+/** #Project 1: Advanced Scheduler T의 recent_cpu와 niceness로 MLFQS Priority 계산 */
+static int mlfqs_calc_priority(struct thread *t) {
+    int priority = fp_to_int(add_mixed(div_mixed(t->recent_cpu, -4), PRI_MAX - t->niceness * 2));
+
+    /* ready 큐 인덱스로 쓰이므로 PRI_MIN..PRI_MAX 범위로 제한 */
+    if (priority < PRI_MIN)
+        priority = PRI_MIN;
+    else if (priority > PRI_MAX)
+        priority = PRI_MAX;
+
+    return priority;
+}
+
+/** #Project 1: Advanced Scheduler MLFQS Recent Cpu 계산하는 함수.
+ *  T에 아직 반영되지 않은 decay를 기록된 계수로 순서대로 적용한다.
+ *  decay_waiters 덕분에 필요한 계수는 항상 기록에 남아 있다. */
 void mlfqs_recent_cpu(struct thread *t) {
-    if (t == idle_thread)
+    int64_t epoch = t->recent_cpu_epoch;
+
+    if (is_idle_thread(t))
         return;
 
-    t->recent_cpu = add_mixed(mult_fp(div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1)), t->recent_cpu), t->niceness);
+    ASSERT(epoch >= decay_epoch - DECAY_HISTORY);
+    for (; epoch < decay_epoch; epoch++)
+        t->recent_cpu = add_mixed(mult_fp(decay_coeff[epoch % DECAY_HISTORY], t->recent_cpu), t->niceness);
+
+    t->recent_cpu_epoch = decay_epoch;
 }
 
 /** #Project 1: Advanced Scheduler MLFQS Load Average 계산하는 함수 */
 void mlfqs_load_avg(void) {
-    int ready_threads;
-
-    ready_threads = list_size(&ready_list);
-
-    if (thread_current() != idle_thread)
-        ready_threads++;
+    /* ready 큐 삽입/삭제 시 갱신되는 값 + idle이 아닌 실행 중 쓰레드 */
+    int ready_threads = ready_cnt + (thread_current() != idle_thread ? 1 : 0);
 
     load_avg = add_fp(mult_fp(div_fp(int_to_fp(59), int_to_fp(60)), load_avg), mult_mixed(div_fp(int_to_fp(1), int_to_fp(60)), ready_threads));
 }
 
 /** #Project 1: Advanced Scheduler MLFQS Recent CPU에 1을 더하는 함수 */
 void mlfqs_increment(void) {
-    if (thread_current() == idle_thread)
+    if (is_idle_thread(thread_current()))
         return;
 
     thread_current()->recent_cpu = add_mixed(thread_current()->recent_cpu, 1);
 }
 
-/** #Project 1: Advanced Scheduler MLFQS 모든 Recent CPU 재계산 */
+/** #Project 1: Advanced Scheduler MLFQS 1초마다 Recent CPU decay.
+ *  이번 decay 계수를 기록하고 실행 중인 쓰레드와 READY 쓰레드에만 바로 적용한다.
+ *  BLOCKED 쓰레드는 thread_unblock()에서 밀린 decay를 적용한다. */
 void mlfqs_recalc_recent_cpu(void) {
-    struct list_elem *e = list_begin(&all_list);
-    thread_t *t = NULL;
+    decay_coeff[decay_epoch % DECAY_HISTORY] = div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1));
+    decay_epoch++;
 
-    while (e != list_end(&all_list)) {
-        t = list_entry(e, thread_t, all_elem);
-        mlfqs_recent_cpu(t);
+    /* 다음 decay에서 지워질 계수가 필요한 BLOCKED 쓰레드를 따라잡는다.
+       따라잡은 뒤의 epoch도 같은 리스트에 해당하므로 그대로 둔다. */
+    struct list *waiters = &decay_waiters[decay_epoch % DECAY_HISTORY];
+    for (struct list_elem *e = list_begin(waiters); e != list_end(waiters); e = list_next(e))
+        mlfqs_recent_cpu(list_entry(e, thread_t, decay_elem));
 
-        e = list_next(e);
+    mlfqs_recent_cpu(thread_current());
+    mlfqs_priority(thread_current());
+
+    /* READY 쓰레드는 priority가 바뀌면 다른 큐로 옮겨지므로 다음 원소를 먼저 저장.
+       옮겨진 쓰레드를 다시 방문해도 이미 최신 값이라 변화가 없다. */
+    for (int pri = PRI_MAX; pri >= PRI_MIN; pri--) {
+        struct list_elem *e = list_begin(&ready_queue[pri]);
+
+        while (e != list_end(&ready_queue[pri])) {
+            thread_t *t = list_entry(e, thread_t, elem);
+
+            e = list_next(e);
+            mlfqs_recent_cpu(t);
+            thread_change_priority(t, mlfqs_calc_priority(t));
+        }
     }
 }
 
-/** #Project 1: Advanced Scheduler MLFQS 모든 Priority 재계산 */
-void mlfqs_recalc_priority(void) {
-    struct list_elem *e = list_begin(&all_list);
-    thread_t *t = NULL;
+/** #Project 1: Advanced Scheduler semaphore WAITERS에서 기다리는 쓰레드들에 밀린 recent_cpu decay를
+ *  적용하고 priority를 다시 계산한다. 1초마다의 갱신은 READY 쓰레드에만 적용되므로 BLOCKED 쓰레드의
+ *  priority는 잠든 시점의 값이다. 깨울 쓰레드를 고르기 전에 불러 최신 값으로 비교하게 한다. */
+void mlfqs_update_waiters(struct heap *waiters) {
+    enum intr_level old_level = intr_disable();
+    struct list stale;
 
-    while (e != list_end(&all_list)) {
-        t = list_entry(e, thread_t, all_elem);
-        mlfqs_priority(t);
+    /* 자리를 다시 잡는 동안에는 heap을 훑을 수 없으므로 모두 꺼냈다가 새 priority로 다시 넣는다.
+       BLOCKED 쓰레드는 ready 큐에 없으므로 elem을 빌려 쓴다. */
+    list_init(&stale);
+    while (!heap_empty(waiters))
+        list_push_back(&stale, &heap_entry(heap_pop_min(waiters), thread_t, wait_elem)->elem);
 
-        e = list_next(e);
+    while (!list_empty(&stale)) {
+        thread_t *t = list_entry(list_pop_front(&stale), thread_t, elem);
+
+        mlfqs_recent_cpu(t);
+        /* 따라잡은 epoch에 맞는 decay_waiters 리스트로 옮긴다 */
+        if (t->decay_waiting) {
+            list_remove(&t->decay_elem);
+            list_push_back(&decay_waiters[t->recent_cpu_epoch % DECAY_HISTORY], &t->decay_elem);
+        }
+        t->priority = mlfqs_calc_priority(t);
+        heap_insert(waiters, &t->wait_elem);
     }
+    intr_set_level(old_level);
+}
+
+/** #Project 1: Advanced Scheduler MLFQS 4 tick마다 Priority 재계산.
+ *  그 사이 recent_cpu가 바뀌는 쓰레드는 실행 중인 쓰레드뿐이다. */
+void mlfqs_recalc_priority(void) {
+    mlfqs_priority(thread_current());
 }
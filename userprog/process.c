@@ -430,7 +430,7 @@ static bool load(const char *file_name, struct intr_frame *if_) {
     process_activate(thread_current());
 
     /* Project 3 : Memory Management - Load Race 방지*/
-    lock_acquire(&filesys_lock); //***** fixed */
+    rwlock_write_acquire(&filesys_lock); //***** fixed */
 
     /* Open executable file. */
     file = filesys_open(file_name);
@@ -513,7 +513,7 @@ done:
     /* We arrive here whether the load is successful or not. */
     // file_close(file);
 
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
 
     return success;
 }
@@ -684,8 +684,7 @@ lazy_load_segment (struct page *page, void *aux) {
 
     file_seek(file, offset); // 파일을 offset부터 읽기
     if (file_read(file, page->frame->kva, page_read_bytes) != (off_t)page_read_bytes) { // 물리 메모리에서 정상적으로 읽어오는지 확인.
-        palloc_free_page(page->frame->kva); // 제대로 못 읽었다면 free 시키고 false return
-        return false;
+        return false; // frame은 frame_table이 가지고 있으므로 여기서 해제하지 않는다
     }
 
     memset(page->frame->kva + page_read_bytes, 0, page_zero_bytes);  //남은 페이지 데이터들은 0으로 초기화
@@ -722,28 +721,15 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-        struct aux *aux = (struct aux *)malloc(sizeof(struct aux));
-        aux->file = file;
-        aux->offset = ofs;
-        aux->page_read_bytes = page_read_bytes;
-
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
-			return false;
-
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-        ofs += page_read_bytes;
+	/** #VMA 세그먼트 전체를 VMA 하나로 등록한다. 페이지 객체와 aux는 처음 접근할 때 만든다.
+	 *  VMA가 파일을 닫으므로 따로 연 핸들을 넘긴다. */
+	file = file_reopen (file);
+	if (file == NULL)
+		return false;
+	if (!vm_map_range (upage, read_bytes + zero_bytes, VM_ANON, writable,
+				file, ofs, read_bytes)) {
+		file_close (file);
+		return false;
 	}
 	return true;
 }
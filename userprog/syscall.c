@@ -28,7 +28,7 @@ void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 
 /** #Project 2: System Call */
-struct lock filesys_lock;  // 파일 읽기/쓰기 용 lock
+struct rwlock filesys_lock;  // 파일 읽기/쓰기 용 lock (read()만 read로 보유)
 
 /* System call.
  *
@@ -53,7 +53,7 @@ void syscall_init(void) {
     write_msr(MSR_SYSCALL_MASK, FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
     /** #Project 2: System Call - read & write 용 lock 초기화 */
-    lock_init(&filesys_lock);
+    rwlock_init(&filesys_lock);
 }
 
 /* The main system call interface */
@@ -155,23 +155,33 @@ void check_address(void *addr) {
 }
 #else
 /** #Project 3: Anonymous Page */
-struct page *check_address(void *addr) {
+/** #VMA 페이지 객체를 만들지 않고, 이미 만들어진 페이지나 VMA가 addr를 덮는지만 본다 */
+bool check_address(void *addr) {
     thread_t *curr = thread_current();
 
     if (is_kernel_vaddr(addr) || addr == NULL)
         exit(-1);
 
-    return spt_find_page(&curr->spt, addr);
+    return spt_is_mapped(&curr->spt, addr, false);
 }
 
 /** Project 3: Memory Mapped Files - 버퍼 유효성 검사 */
 void check_valid_buffer(void *buffer, size_t size, bool writable) {
-    for (size_t i = 0; i < size; i++) {
-        /* buffer가 spt에 존재하는지 검사 */
-        struct page *page = check_address(buffer + i);
+    if (size == 0)
+        return;
+
+    /* 같은 페이지의 바이트는 결과가 같으므로 buffer가 걸친 페이지마다 한 번씩만 찾는다 */
+    void *last = pg_round_down(buffer + size - 1);
 
-        if (!page || (writable && !(page->writable)))
+    if (last < pg_round_down(buffer))  // 주소 공간 끝을 넘어 감
+        exit(-1);
+    for (void *upage = pg_round_down(buffer); ; upage += PGSIZE) {
+        /* buffer가 spt나 VMA에 존재하는지 검사. 검사만으로 페이지 객체를 만들지 않는다 */
+        if (is_kernel_vaddr(upage) || upage == NULL
+                || !spt_is_mapped(&thread_current()->spt, upage, writable))
             exit(-1);
+        if (upage == last)
+            break;
     }
 }
 #endif
@@ -223,9 +233,9 @@ int wait(pid_t tid) {
 bool create(const char *file, unsigned initial_size) {
     check_address(file);
 
-    lock_acquire(&filesys_lock);
+    rwlock_write_acquire(&filesys_lock);
     bool success = filesys_create(file, initial_size);
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
 
     return success;
 }
@@ -234,9 +244,9 @@ bool create(const char *file, unsigned initial_size) {
 bool remove(const char *file) {
     check_address(file);
 
-    lock_acquire(&filesys_lock);
+    rwlock_write_acquire(&filesys_lock);
     bool success = filesys_remove(file);
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
 
     return success;
 }
@@ -245,7 +255,7 @@ bool remove(const char *file) {
 int open(const char *file) {
     check_address(file);
 
-    lock_acquire(&filesys_lock);
+    rwlock_write_acquire(&filesys_lock);
     struct file *newfile = filesys_open(file);
 
     if (newfile == NULL)
@@ -256,10 +266,10 @@ int open(const char *file) {
     if (fd == -1)
         file_close(newfile);
 
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
     return fd;
 err:
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
     return -1;
 }
 
@@ -302,9 +312,9 @@ int read(int fd, void *buffer, unsigned length) {
     }
 
     // 그 외의 경우
-    lock_acquire(&filesys_lock);
+    rwlock_read_acquire(&filesys_lock);
     off_t bytes = file_read(file, buffer, length);
-    lock_release(&filesys_lock);
+    rwlock_read_release(&filesys_lock);
 
     return bytes;
 }
@@ -316,7 +326,7 @@ int write(int fd, const void *buffer, unsigned length) {
 #endif
     check_address(buffer);
 
-    lock_acquire(&filesys_lock);
+    rwlock_write_acquire(&filesys_lock);
     thread_t *curr = thread_current();
     off_t bytes = -1;
 
@@ -334,7 +344,7 @@ int write(int fd, const void *buffer, unsigned length) {
     bytes = file_write(file, buffer, length);
 
 done:
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
     return bytes;
 }
 
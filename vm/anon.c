@@ -3,6 +3,10 @@
 #include "vm/vm.h"
 #include "devices/disk.h"
 #include "vm/anon.h"
+#include "vm/zswap.h"
+#include "threads/mmu.h"
+#include "threads/malloc.h"
+#include "filesys/inode.h"
 #include "lib/kernel/bitmap.h"
 
 /* DO NOT MODIFY BELOW LINE */
@@ -21,6 +25,16 @@ static const struct page_operations anon_ops = {
 
 struct bitmap *swap_table;
 size_t slot_max;
+/** #Clustered Swap 다음 slot 탐색을 시작할 위치. 매번 0번부터 훑지 않고 이어서 찾는다.
+ *  slot 할당은 모두 frame_table_lock 아래에서 일어나므로 따로 잠그지 않는다. */
+static size_t swap_cursor;
+/** #Shared Eviction slot마다 그 slot을 함께 가리키는 페이지 수 - 1. 공유 frame을 내보낼 때만 0보다 크다 */
+static int *swap_shares;
+
+static size_t swap_slot_alloc (size_t cnt);
+static void swap_slot_put (size_t slot);
+static bool anon_swap_out_shared (struct frame *frame);
+static void swap_io (bool write, size_t slot, void *kvas[], size_t cnt);
 
 /* Initialize the data for anonymous pages */
 /* HDD과 연관되지 않는 anon type에 대해, init을 */
@@ -30,6 +44,10 @@ void vm_anon_init(void) {
     slot_max = disk_size(swap_disk) / SLOT_SIZE; // 디스크 크기와 슬롯 크기를 이용해 사용할 수 있는 스왑 슬롯의 최대 개수를 계산
     swap_table = bitmap_create(slot_max); // 스왑 슬롯 사용여부를 확인하기 위해 비트를 이용. 따라서, slot_max의 크기에 해당하는 bit string 생성 
 	                                      // ex) 01000001 이면 1 사용중 / 0 사용 가능
+    swap_shares = calloc(slot_max, sizeof *swap_shares);
+    if (swap_shares == NULL)
+        PANIC("vm_anon_init: out of memory");
+    zswap_init();
 }
 /* Initialize the file mapping */
 bool
@@ -44,6 +62,8 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) { // kva; ker
 
 	struct anon_page *anon_page = &page->anon;// page union에서 UNINIT이 아니라, anon을 가리키도록 설정.
 	anon_page->slot = BITMAP_ERROR; // 아직 해당 페이지가 Swap 영역에 저장되지 않았음을 나타냄. 유효한 swap 슬롯이 없음.
+	anon_page->zswap = NULL;
+	anon_page->text_inode = NULL;
 
 	return true;
 }
@@ -57,18 +77,76 @@ anon_swap_in (struct page *page, void *kva) {
 	 * 해당 페이지 정보를 mmap을 통해 가져오고,
 	 * page - frame간의 링크를 형성한다. */
 	struct anon_page *anon_page = &page->anon;
-	size_t slot = anon_page->slot;
-	size_t sector = slot * SLOT_SIZE;
+	size_t slot;
+	struct page *pages[SWAP_CLUSTER];
+	void *kvas[SWAP_CLUSTER];
+	size_t cnt = 1;
+
+	/** #Compressed Swap 압축 캐시에 있으면 디스크까지 가지 않는다.
+	 *  캐시에서 디스크로 쓰는 중이었다면 끝날 때까지 기다렸다가 디스크에서 읽는다. */
+	if (zswap_load(page, kva))
+		return true;
 
+	slot = anon_page->slot;
+	/** #Shared Text 내보내면서 버린 실행 파일 페이지는 파일에서 다시 읽는다 */
+	if (slot == BITMAP_ERROR && anon_page->text_inode != NULL) {
+		if (inode_read_at(anon_page->text_inode, kva, anon_page->text_bytes, anon_page->text_ofs)
+				!= (off_t) anon_page->text_bytes)
+			return false;
+		memset(kva + anon_page->text_bytes, 0, PGSIZE - anon_page->text_bytes);
+		return true;
+	}
 	if (slot == BITMAP_ERROR || !bitmap_test(swap_table, slot)) // 페이지가 swap 디스크에 저장된 정보가 없는 경우. 슬롯이 사용중이 아닌 경우 - false
 		return false;
-	
-	bitmap_set(swap_table, slot, false); // swap_in이 되었으므로 해당 slot은 사용 중이 아니므로, 이를 bitmap에 표시해 준다.
 
-	for (size_t i = 0; i < SLOT_SIZE; i ++) // SLOT_SIZE는 한 페이지를 저장하는 데 필요한 디스크 섹터 수를 의미한다.
-		disk_read(swap_disk, sector + i, kva + DISK_SECTOR_SIZE * i); // 모든 섹터를 읽어와 페이지 전체 데이터를 복원.
+	/** #Clustered Swap 같은 프로세스의 바로 다음 가상 페이지들이 바로 다음 slot에 있으면 함께 읽는다.
+	 *  free frame이 넉넉할 때만 미리 읽으며, 안 쓰인 페이지는 accessed bit가 없어 clock이 먼저 내보낸다. */
+	pages[0] = page;
+	kvas[0] = kva;
+	while (cnt < SWAP_CLUSTER) {
+		/* swap된 페이지는 이미 만들어져 있으므로 VMA에서 새로 만들지 않는다 */
+		struct page *next = spt_find_page(&page->owner->spt, page->va + cnt * PGSIZE);
+		struct frame *frame;
+
+		if (next == NULL || next->operations != &anon_ops || next->frame != NULL
+				|| next->anon.slot != slot + cnt)
+			break;
+		frame = vm_frame_prefetch(next);
+		if (frame == NULL)
+			break;
+		pages[cnt] = next;
+		kvas[cnt] = frame->kva;
+		cnt++;
+	}
+
+	swap_io(false, slot, kvas, cnt); // 모든 섹터를 한 번에 읽어와 페이지 전체 데이터를 복원.
+
+	/* 같은 slot을 가리키는 다른 페이지가 동시에 읽어 갈 수 있으므로 lock을 잡고 놓는다 */
+	vm_frame_table_acquire();
+	for (size_t i = 0; i < cnt; i++) {
+		swap_slot_put(slot + i); // swap_in이 되었으므로 해당 slot을 더 쓰는 페이지가 없으면 bitmap에 표시해 준다.
+		pages[i]->anon.slot = BITMAP_ERROR; // 해당 페이지가 swap out 상태가 아님을 표시.
+		if (i > 0)
+			pages[i]->frame->pinned = false;
+	}
+	vm_frame_table_release();
+
+	return true;
+}
+
+/** Project 3: Copy On Write (Extra) swap out된 PAGE의 내용을 swap slot은 그대로 둔 채 KVA로 읽어 온다. */
+bool
+anon_swap_copy (struct page *page, void *kva) {
+	size_t slot;
+
+	if (zswap_copy(page, kva))
+		return true;
+
+	slot = page->anon.slot;
+	if (slot == BITMAP_ERROR || !bitmap_test(swap_table, slot))
+		return false;
 
-	sector = BITMAP_ERROR; // 해당 페이지가 swap out 상태가 아님을 표시.
+	swap_io(false, slot, &kva, 1);
 
 	return true;
 }
@@ -80,28 +158,154 @@ anon_swap_out (struct page *page) {
 	 * swap 영역에서 slot 할당 받기
 	 * (slot을 할당 받았다면) 해당 slot에 메모리 넣고, 해당 RAM을 free
 	 * (swap disk 초과로 할당 받지 못했다면) 커널 패닉 */
-	struct anon_page *anon_page = &page->anon;
+	struct frame *frame = page->frame;
+
+	/** #Shared Text 실행 파일에서 다시 읽을 수 있으므로 쓰지 않고 모든 mapping을 지운 뒤 버린다 */
+	if (page->anon.text_inode != NULL) {
+		vm_frame_unmap(frame);
+		vm_frame_detach(frame);
+		return true;
+	}
+	if (frame->ref_cnt > 1)
+		return anon_swap_out_shared(frame);
+	return anon_swap_out_cluster(&page, 1);
+}
 
-	size_t free_idx = bitmap_scan_and_flip(swap_table, 0, 1, false); // 빈 슬롯을 탐색하고 해당 슬롯을 사용 중으로 표시. 
+/** #Shared Eviction fork 후 공유 중인 FRAME을 slot 하나에 한 번만 쓰고, 공유하던 페이지가 모두 그 slot을
+ *  가리키게 한다. slot은 마지막 페이지가 읽어 가거나 해제할 때 비워진다.
+ *  압축 캐시 entry는 페이지 하나에만 달리므로 거치지 않는다. */
+static bool
+anon_swap_out_shared (struct frame *frame) {
+	size_t slot = swap_slot_alloc(1);
+	struct list_elem *e;
 
-	if (free_idx == BITMAP_ERROR) // swap slot이 없으면 False 반환.
+	if (slot == BITMAP_ERROR)
 		return false;
-	
-	size_t sector = free_idx * SLOT_SIZE; // 디스크에 저장할 위치
 
-	for (size_t i = 0; i < SLOT_SIZE; i++)
-		disk_write(swap_disk, sector + i, page->va + DISK_SECTOR_SIZE *i); // swap 디스크에 페이지 데이터를 기록.
-	
-	anon_page->slot = free_idx; // 데이터가 저장된 swap slot에 대한 정보를 저장.
+	/* 쓰는 동안 어느 공유자도 내용을 바꾸지 못하게 mapping을 먼저 지운다 */
+	vm_frame_unmap(frame);
+	swap_io(true, slot, &frame->kva, 1);
 
-	// page 와 frame간에 링크를 끊고, pml4에서 해당 페이지를 clear
-	page->frame->page = NULL;
-	page->frame = NULL;
-	pml4_clear_page(thread_current()->pml4, page->va);
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e))
+		list_entry(e, struct page, share_elem)->anon.slot = slot;
+	swap_shares[slot] = frame->ref_cnt - 1;
+	vm_frame_detach(frame);
+	return true;
+}
 
+/** #Clustered Swap 익명 페이지 CNT개를 연속된 slot에 한 번의 디스크 명령으로 쓴다.
+ *  같은 프로세스의 인접한 가상 페이지가 인접한 slot에 놓이도록 (owner, va) 순으로 정렬해서
+ *  anon_swap_in()이 함께 읽어 올 수 있게 한다. 연속된 slot이 없으면 false.
+ *  #Compressed Swap 먼저 압축 캐시에 넣어 보고, 넣지 못한 페이지만 디스크로 보낸다. */
+bool
+anon_swap_out_cluster (struct page *pages[], size_t cnt) {
+	void *kvas[SWAP_CLUSTER];
+	size_t disk_cnt = 0;
+	size_t slot;
+
+	ASSERT(cnt >= 1 && cnt <= SWAP_CLUSTER);
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *page = pages[i];
+		uint64_t *pml4 = page->owner->pml4;
+
+		/* 압축하는 동안 소유자가 내용을 바꾸지 못하게 mapping을 지웠다가, 실패하면 되돌린다 */
+		pml4_clear_page(pml4, page->va);
+		if (zswap_store(page, page->frame->kva)) {
+			page->frame->page = NULL;
+			page->frame = NULL;
+		} else {
+			pml4_set_page(pml4, page->va, page->frame->kva, page->writable);
+			pages[disk_cnt++] = page;
+		}
+	}
+	if (disk_cnt == 0)
+		return true;
+	cnt = disk_cnt;
+
+	for (size_t i = 1; i < cnt; i++) {
+		struct page *page = pages[i];
+		size_t j = i;
+
+		for (; j > 0 && (pages[j - 1]->owner > page->owner
+				|| (pages[j - 1]->owner == page->owner && pages[j - 1]->va > page->va)); j--)
+			pages[j] = pages[j - 1];
+		pages[j] = page;
+	}
+
+	slot = swap_slot_alloc(cnt); // 빈 슬롯을 탐색하고 해당 슬롯을 사용 중으로 표시.
+	if (slot == BITMAP_ERROR) // swap slot이 없으면 False 반환.
+		return false;
+
+	/** Project 3: Page Reclaim 쓰는 동안 소유자가 내용을 바꾸지 못하도록 mapping을 먼저 지운다.
+	 *  그 사이의 fault는 vm_try_handle_fault()에서 swap out이 끝나기를 기다린다. */
+	for (size_t i = 0; i < cnt; i++) {
+		pml4_clear_page(pages[i]->owner->pml4, pages[i]->va);
+		/* 다른 프로세스의 페이지일 수도 있으므로 user 주소가 아닌 frame의 커널 주소에서 읽는다 */
+		kvas[i] = pages[i]->frame->kva;
+	}
+
+	swap_io(true, slot, kvas, cnt); // swap 디스크에 페이지 데이터를 기록.
+
+	for (size_t i = 0; i < cnt; i++) {
+		pages[i]->anon.slot = slot + i; // 데이터가 저장된 swap slot에 대한 정보를 저장.
+
+		// page 와 frame간에 링크를 끊는다
+		pages[i]->frame->page = NULL;
+		pages[i]->frame = NULL;
+	}
+
+	return true;
+}
+
+/** #Compressed Swap 압축 캐시에서 밀려난 PAGE의 내용 KVA를 빈 slot에 쓴다. slot이 없으면 false. */
+bool
+anon_swap_write (struct page *page, void *kva) {
+	size_t slot = swap_slot_alloc(1);
+
+	if (slot == BITMAP_ERROR)
+		return false;
+	swap_io(true, slot, &kva, 1);
+	page->anon.slot = slot;
 	return true;
 }
 
+/** #Clustered Swap 연속된 CNT개의 빈 slot을 찾아 사용 중으로 표시하고 첫 slot을 반환한다.
+ *  swap_cursor부터 찾고, 없으면 처음부터 다시 찾는다. */
+static size_t
+swap_slot_alloc (size_t cnt) {
+	size_t slot = bitmap_scan_and_flip(swap_table, swap_cursor, cnt, false);
+
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip(swap_table, 0, cnt, false);
+	if (slot != BITMAP_ERROR)
+		swap_cursor = slot + cnt < slot_max ? slot + cnt : 0;
+	return slot;
+}
+
+/** #Shared Eviction SLOT을 가리키던 페이지 하나가 더 이상 쓰지 않는다. 마지막 페이지였으면 slot을 비운다 */
+static void
+swap_slot_put (size_t slot) {
+	if (swap_shares[slot] > 0)
+		swap_shares[slot]--;
+	else
+		bitmap_reset(swap_table, slot);
+}
+
+/** #Clustered Swap SLOT부터 연속된 CNT개의 slot과 페이지 KVAS 사이를 한 번의 디스크 명령으로 옮긴다 */
+static void
+swap_io (bool write, size_t slot, void *kvas[], size_t cnt) {
+	void *buffers[SWAP_CLUSTER * SLOT_SIZE];
+
+	for (size_t i = 0; i < cnt * SLOT_SIZE; i++)
+		buffers[i] = kvas[i / SLOT_SIZE] + DISK_SECTOR_SIZE * (i % SLOT_SIZE);
+
+	if (write)
+		disk_write_multiple(swap_disk, slot * SLOT_SIZE, cnt * SLOT_SIZE, buffers);
+	else
+		disk_read_multiple(swap_disk, slot * SLOT_SIZE, cnt * SLOT_SIZE, buffers);
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
@@ -110,15 +314,32 @@ anon_destroy (struct page *page) {
 	 * anon이 사용 중인 리소스 해제, page는 caller가 해제할 것이므로 신경 안써도 된다.
 	 * anon이 사용 중인 frame, page를 해제*/
 
+	/** #Compressed Swap 압축 캐시에 있으면 버린다. 디스크로 쓰는 중이면 끝난 뒤 slot을 해제한다.
+	 *  reclaim이 이 페이지를 내보내는 중이면 slot은 잡혔는데 frame은 아직 남아 있으므로,
+	 *  frame_table_lock을 잡아 swap out이 끝난 뒤에 frame과 slot을 읽고 해제한다. */
+	vm_frame_table_acquire();
+	zswap_invalidate(page);
+
 	// 점거 중인 bitmap 삭제
-	if (anon_page->slot != BITMAP_ERROR)
-		bitmap_reset(swap_table, anon_page->slot);
+	if (anon_page->slot != BITMAP_ERROR) {
+		swap_slot_put(anon_page->slot);
+		anon_page->slot = BITMAP_ERROR;
+	}
+
+	if (page->frame && page->frame->ref_cnt > 1) {
+		/** Project 3: Copy On Write (Extra) 다른 프로세스와 공유 중인 frame은 연결만 끊는다.
+		 *  pml4_destroy()가 frame을 해제하지 않도록 mapping도 지운다. */
+		vm_frame_unlink(page);
+		pml4_clear_page(thread_current()->pml4, page->va);
+	} else if (page->frame) {
+		/* lock을 놓기 전에 물리 페이지까지 돌려주므로 mapping을 지워 pml4_destroy()가 다시 돌려주지 않게 한다 */
+		struct frame *frame = page->frame;
 
-	if (page->frame) {
-		list_remove(&page->frame->frame_elem); // 리스트에서 해당 frame 제거
-		page->frame->page = NULL; // frame이 page를 가리키는 포인터 제거. NULL
-		free(page->frame); // 이후, frame을 free
+		pml4_clear_page(thread_current()->pml4, page->va);
+		frame->page = NULL; // frame이 page를 가리키는 포인터 제거. NULL
 		page->frame = NULL; // page가 frame을 가리키는 포인터 제거. NULL
+		vm_frame_remove(frame); // frame_table에서 해당 frame 제거
+		palloc_free_page(frame->kva);
 	}
-
+	vm_frame_table_release();
 }
@@ -1,6 +1,7 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <round.h>
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
 #include "userprog/process.h"
@@ -61,15 +62,17 @@ file_backed_swap_out (struct page *page) {
 	 * (true) file에 변경사항 저장. dirty하지 않다고 명시
 	 * (false) 바로 swap_out 진행. RAM에서 해당 frame 사용 중이지 않다고 명시.*/
 	struct file_page *file_page UNUSED = &page->file;
-	if (pml4_is_dirty(thread_current()->pml4, page->va)) { // dirty인지 확인. 더럽다면 file에 적어두고, dirty이지 않다고 명시
-		file_write_at(file_page->file, page->va, file_page->page_read_bytes, file_page->offset);
-		pml4_set_dirty(thread_current()->pml4, page->va, false);
-	}
+	/* 다른 프로세스의 페이지일 수도 있으므로 소유자의 pml4와 frame의 커널 주소를 사용 */
+	struct frame *frame = page->frame;
+
+	/** Project 3: Page Reclaim 쓰는 동안 소유자가 내용을 바꾸지 못하도록 mapping을 먼저 지운다.
+	 *  #Shared Eviction fork로 공유 중인 frame이면 모든 프로세스의 mapping을 지우고 한 번만 되돌려 쓴다 */
+	bool dirty = vm_frame_unmap(frame);
+	if (dirty) // dirty인지 확인. 더럽다면 file에 적어둔다
+		file_write_at(file_page->file, frame->kva, file_page->page_read_bytes, file_page->offset);
 
 	//page와 frame 연관관계 끊기
-	page->frame->page = NULL;
-	page->frame = NULL;
-	pml4_clear_page(thread_current()->pml4, page->va);
+	vm_frame_detach(frame);
 
 	return true; // 이걸 잊었었다...
 }
@@ -84,58 +87,52 @@ file_backed_destroy (struct page *page) {
 		pml4_set_dirty(thread_current()->pml4, page->va, false); // file에 수정 사항을 반영 했으므로, dirty = false;
 	}
 
-	if (page->frame) {// page와 frame사이에 link를 해제하고, frame 또한 해제한다. page는 caller가 해제할 것이다.
-		list_remove(&page->frame->frame_elem);
-		page->frame->page = NULL;
+	/** #Frame Table reclaim이 이 페이지를 내보내는 중일 수 있으므로 frame_table_lock을 잡은 뒤에
+	 *  frame을 읽고 해제한다 */
+	vm_frame_table_acquire();
+	if (page->frame && page->frame->ref_cnt > 1) {
+		/** Project 3: Copy On Write (Extra) 다른 프로세스와 공유 중인 frame은 연결만 끊는다. */
+		vm_frame_unlink(page);
+	} else if (page->frame) {// page와 frame사이에 link를 해제하고, frame 또한 해제한다. page는 caller가 해제할 것이다.
+		/** #Frame Table 아래에서 mapping을 지우면 pml4_destroy()가 물리 페이지를 돌려주지 않으므로 여기서 돌려준다 */
+		struct frame *frame = page->frame;
+
+		pml4_clear_page(thread_current()->pml4, page->va);
+		frame->page = NULL;
 		page->frame = NULL;
-		free(page->frame);
+		vm_frame_remove(frame);
+		palloc_free_page(frame->kva);
 	}
+	vm_frame_table_release();
 
 	pml4_clear_page(thread_current()->pml4, page->va); // pml4에 있던 va도 clear한다.
 }
 
 /* Do the mmap / mmap이 매핑 가능 조건을 확인하는 함수였다면, do_mmap은 실제 매핑을 진행하는 함수.*/
 void *do_mmap(void *addr, size_t length, int writable, struct file *file, off_t offset) {
-    lock_acquire(&filesys_lock); // 파일 시스템에 동시 접근하지 않도록 잠금.
+    rwlock_write_acquire(&filesys_lock); // 파일 시스템에 동시 접근하지 않도록 잠금.
     struct file *mfile = file_reopen(file); //reopen을 통해 파일 핸들을 복제해서 독립적으로 파일을 사용할 수 있도록 설정.
     void *ori_addr = addr; // 매핑이 성공했을 때 반환할 원래 주소.
-    size_t read_bytes = (length > file_length(mfile)) ? file_length(mfile) : length;
-    size_t zero_bytes = PGSIZE - read_bytes % PGSIZE;
+    size_t read_bytes;
+
+    if (mfile == NULL)
+        goto err;
+    read_bytes = (length > file_length(mfile)) ? file_length(mfile) : length;
 
-    ASSERT((read_bytes + zero_bytes) % PGSIZE == 0); // 페이지 단위인지 확인.
     ASSERT(pg_ofs(addr) == 0); // 시작 주소가 페이지 경계인지 확인.
     ASSERT(offset % PGSIZE == 0);
 
-    struct aux *aux;
-    while (read_bytes > 0 || zero_bytes > 0) {
-		// 페이지 단위로 page_read_bytes와 page_zero_bytes를 사용.
-        size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-        size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-        aux = (struct aux *)malloc(sizeof(struct aux)); // aux 동적 할당.
-        if (!aux)
-            goto err;
-
-        aux->file = mfile; // file 정보
-        aux->offset = offset; // offset 정보
-        aux->page_read_bytes = page_read_bytes; // 바이트 정보
-
-        if (!vm_alloc_page_with_initializer(VM_FILE, addr, writable, lazy_load_segment, aux)) { // vm_alloc_page_with_initializer로 페이지 할당.
-            goto err;
-        }
-
-        read_bytes -= page_read_bytes; // 처리한 바이트 수를 전체 바이트 수에서 빼주기.
-        zero_bytes -= page_zero_bytes;
-        addr += PGSIZE; // 다음에 읽을 addr를 찾기 위해 PGSIZE를 더해줌.
-        offset += page_read_bytes;
+    /** #VMA 매핑 전체를 VMA 하나로 등록한다. 페이지 객체는 처음 접근할 때 만들고, mfile은 VMA가 닫는다 */
+    if (!vm_map_range(addr, ROUND_UP(read_bytes, PGSIZE), VM_FILE, writable, mfile, offset, read_bytes)) {
+        file_close(mfile);
+        goto err;
     }
-    lock_release(&filesys_lock); // acquire했던 lock 놔주기
+    rwlock_write_release(&filesys_lock); // acquire했던 lock 놔주기
 
     return ori_addr; // 할당 성공 시, 주소 반환
 
 err:
-    free(aux);
-    lock_release(&filesys_lock);
+    rwlock_write_release(&filesys_lock);
     return NULL; // 실패 시, NULL 반환.
 }
 
@@ -148,15 +145,8 @@ void
 	 * (작성 안된 경우) file에 반영 안하고 반환 
 	 */
 
-	struct thread *curr = thread_current();
-	struct page *page;
-
-	lock_acquire(&filesys_lock);
-	while((page = spt_find_page(&curr->spt, addr))) {
-		if (page)
-			destroy(page); // destory(page)를 한다는 건, 해당 프로세스를 위해 PM에 할당된 메모리 지우기.
-
-		addr += PGSIZE;
-	}
-	lock_release(&filesys_lock);
+	/** #VMA addr에서 시작하는 매핑의 페이지를 모두 없애고(수정된 내용은 파일에 반영) 파일을 닫는다 */
+	rwlock_write_acquire(&filesys_lock);
+	vm_unmap_range(addr);
+	rwlock_write_release(&filesys_lock);
 }
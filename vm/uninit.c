@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/malloc.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -55,8 +56,12 @@ uninit_initialize (struct page *page, void *kva) {
 	/* uninit->type이, VM_UNINIT일 테니까, 페이지 타입에 따라, VM_ANON 또는, VM_FILE을 저장해줌.
 	 * .init을 이용해서, anon_initializer, file_backed_initializer를 저장
 	 */
-	return uninit->page_initializer (page, uninit->type, kva) && //kva = kernel virtual address
+	bool success = uninit->page_initializer (page, uninit->type, kva) && //kva = kernel virtual address
 		(init ? init (page, aux) : true);
+
+	/** #VMA aux는 페이지마다 따로 만들어 둔 것이므로 다 읽었으면 해제 */
+	free (aux);
+	return success;
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
@@ -72,5 +77,5 @@ uninit_destroy (struct page *page) {
 	 * TODO: If you don't have anything to do, just return. */
 	/* pseudo
 	 * page의 상태를 확인하고 UNINIT이라면, spt에서 해제시키면 되는 거 아닌가? -> 근데 그건 이미 spt_kill에서,,,하니까 그냥 return 만 하면 됨.*/
-	return;
+	free (uninit->aux);
 }
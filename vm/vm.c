@@ -1,16 +1,71 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <round.h>
+
 #include "threads/malloc.h"
 #include "threads/vaddr.h"
 
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/zswap.h"
 #include "userprog/process.h"
 #include "vm/inspect.h"
 #include "threads/mmu.h"
 #include "lib/kernel/hash.h"
+#include "lib/kernel/bitmap.h"
+
+/** #Frame Table user pool 전체를 덮는 frame 배열. 힙이 아닌 kernel pool에서 한 번에 받아 둔다 */
+static struct frame *frame_table;
+static void *frame_base;            /* frame_table[0]의 kva */
+static size_t frame_table_size;
+/** Project 3: Memory Management frame_table과 clock_hand 보호 */
+static struct lock frame_table_lock;
+/** Project 3: Memory Management clock 알고리즘이 다음에 검사할 frame의 번호. 모든 프로세스가 공유한다 */
+static size_t clock_hand;
+
+/** Project 3: Page Reclaim user pool의 free frame이 reclaim_low 아래로 내려가면 reclaim 스레드를 깨워
+ *  reclaim_high가 될 때까지 frame을 내보낸다. fault 경로는 대부분 바로 free frame을 얻는다. */
+#define RECLAIM_LOW_DIV 64  /* low watermark = 전체 user frame / RECLAIM_LOW_DIV */
+#define RECLAIM_LOW_MIN 8
+static size_t reclaim_low, reclaim_high;
+static struct semaphore reclaim_sema;
+static bool reclaim_running;
+static unsigned long long reclaim_wakeups;  /* reclaim 스레드가 깨어난 횟수 */
+static unsigned long long reclaim_cnt;      /* reclaim 스레드가 내보낸 frame 수 */
+static unsigned long long direct_reclaim_cnt; /* fault 경로에서 직접 내보낸 frame 수 */
+
+static void vm_reclaim_daemon (void *aux);
+
+/** #Shared Text 여러 프로세스가 같은 실행 파일의 읽기 전용 페이지를 한 frame으로 공유하도록
+ *  (inode, offset, 읽을 바이트 수)로 frame을 찾는 캐시. 공유하는 페이지가 모두 사라지거나 frame이
+ *  내보내지면 캐시에서 빠진다. frame_table_lock이 보호한다. */
+static struct hash text_cache;
+static uint64_t text_hash (const struct hash_elem *e, void *aux);
+static bool text_less (const struct hash_elem *a, const struct hash_elem *b, void *aux);
+static bool vm_text_key (struct page *page, struct frame *key);
+static bool vm_map_text_page (struct page *page, struct frame *key);
+static void vm_text_cache_insert (struct page *page, struct frame *key);
+static void text_cache_remove (struct frame *frame);
+static void text_page_set_source (struct page *page, struct frame *key);
 
-static struct list frame_table;
+/** #Fault Around */
+size_t fault_around_pages = FAULT_AROUND_DEFAULT;
+static struct file *vm_page_file (struct page *page);
+static void vm_fault_around (struct page *page, struct file *file);
+
+/** #Zero Page 한 번도 쓰지 않은 익명 페이지들이 읽기 전용으로 함께 매핑하는, 0으로 채워진 frame.
+ *  frame_table에 넣지 않으므로 내보내지지 않는다. ref_cnt를 1부터 세어 항상 공유 중으로 보이게 하므로
+ *  첫 쓰기는 vm_handle_wp()가 copy-on-write와 같은 방법으로 새 frame에 옮긴다. */
+static struct frame zero_frame;
+
+/** #Huge Page 한 번도 건드리지 않은 2 MB 익명 구간 전체를 2 MB 페이지 하나로 매핑한다.
+ *  페이지 객체와 frame은 4 KB 단위로 그대로 두므로, 한 페이지만 내보내거나 copy-on-write로
+ *  권한을 바꾸면 mmu가 그 2 MB 매핑을 4 KB 페이지 테이블로 쪼갠다. */
+#define HUGE_PAGES (PGSIZE_2M / PGSIZE)
+static unsigned long long huge_cnt;         /* 2 MB로 매핑한 횟수 */
+static bool vm_map_huge (struct page *page);
+static void huge_count_page (struct page *page, void *cnt);
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -24,7 +79,43 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table);
+	/** #Frame Table */
+	frame_table_size = palloc_pool_range(PAL_USER, &frame_base);
+	frame_table = palloc_get_multiple(PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP(frame_table_size * sizeof(struct frame), PGSIZE));
+	for (size_t i = 0; i < frame_table_size; i++)
+		frame_table[i].kva = frame_base + i * PGSIZE;
+	lock_init(&frame_table_lock);
+	clock_hand = 0;
+
+	/** Project 3: Page Reclaim */
+	reclaim_low = palloc_free_cnt(PAL_USER) / RECLAIM_LOW_DIV;
+	if (reclaim_low < RECLAIM_LOW_MIN)
+		reclaim_low = RECLAIM_LOW_MIN;
+	reclaim_high = reclaim_low * 2;
+	sema_init(&reclaim_sema, 0);
+	thread_create("reclaim", PRI_DEFAULT, vm_reclaim_daemon, NULL);
+
+	/** #Shared Text */
+	hash_init(&text_cache, text_hash, text_less, NULL);
+
+	/** #Zero Page */
+	zero_frame.kva = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+	zero_frame.page = NULL;
+	list_init(&zero_frame.pages);
+	zero_frame.ref_cnt = 1;
+	zero_frame.pinned = true;
+}
+
+/** Project 3: Page Reclaim free frame 수, watermark와 reclaim 횟수를 출력 */
+void
+vm_print_stats (void) {
+	printf("VM: %zu free frames, watermarks %zu low %zu high\n",
+			palloc_free_cnt(PAL_USER), reclaim_low, reclaim_high);
+	printf("VM: reclaim woke %llu times, %llu frames reclaimed, %llu direct\n",
+			reclaim_wakeups, reclaim_cnt, direct_reclaim_cnt);
+	printf("VM: %llu huge pages mapped\n", huge_cnt);
+	zswap_print_stats();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -45,6 +136,21 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static void vm_frame_link (struct frame *frame, struct page *page);
+static void frame_link_locked (struct frame *frame, struct page *page);
+static bool vm_frame_accessed (struct frame *frame);
+static bool vm_zero_fillable (struct page *page);
+static bool vm_map_zero_page (struct page *page);
+static struct frame *frame_table_insert (void *kva);
+static void frame_table_remove (struct frame *frame);
+static size_t vm_reclaim_frames (void);
+static void vm_reclaim_wakeup (void);
+static struct page *page_new (enum vm_type type, void *upage, bool writable,
+		vm_initializer *init, void *aux);
+static struct page *spt_materialize (struct supplemental_page_table *spt,
+		struct vma *vma, void *va);
+static void spt_destroy_page (struct page *page, void *spt);
+static void spt_mark_occupied (struct page *page, void *occupied);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -70,28 +176,122 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * swap_in handler 설정 
 		 * 초기화 함수(vm_initializer) 설정. page type에 따라, anon_initializer or. lazy_load_segment 
 		 * spt에 field가 설정된 uninit페이지 추가 */
-		struct page *page = (struct page *)malloc(sizeof(struct page));
+		struct page *page = page_new(type, upage, writable, init, aux);
 
-		typedef bool (*initializerFunc)(struct page *, enum vm_type, void *);
-		initializerFunc initializer = NULL;
-
-		switch (VM_TYPE(type)) {
-			case VM_ANON:
-				initializer = anon_initializer;
-				break;
-			case VM_FILE:
-				initializer = file_backed_initializer;
-				break;
+		if (page == NULL)
+			goto err;
+		if (!spt_insert_page(spt, page)) {
+			free(page);
+			goto err;
 		}
+		return true;
+	}
+err:
+	return false;
+}
 
-		uninit_new(page, upage, init, type, aux, initializer);
-		page->writable = writable;
+/** #VMA 페이지 객체를 UNINIT 상태로 만든다. 소유자는 현재 스레드 */
+static struct page *
+page_new (enum vm_type type, void *upage, bool writable, vm_initializer *init, void *aux) {
+	struct page *page = (struct page *)malloc(sizeof(struct page));
 
-		return spt_insert_page(spt, page);
+	typedef bool (*initializerFunc)(struct page *, enum vm_type, void *);
+	initializerFunc initializer = NULL;
 
+	if (page == NULL)
+		return NULL;
+
+	switch (VM_TYPE(type)) {
+		case VM_ANON:
+			initializer = anon_initializer;
+			break;
+		case VM_FILE:
+			initializer = file_backed_initializer;
+			break;
 	}
-err:
-	return false;
+
+	uninit_new(page, upage, init, type, aux, initializer);
+	page->writable = writable;
+	page->owner = thread_current();
+	return page;
+}
+
+/** #VMA 현재 프로세스의 [ADDR, ADDR + LENGTH)를 하나의 VMA로 매핑한다. 페이지 객체는 만들지 않는다.
+ *  FILE이 있으면 OFFSET부터 READ_BYTES 바이트를 읽고 나머지는 0으로 채운다. FILE은 VMA가 가지고
+ *  unmap하거나 프로세스가 끝날 때 닫는다. 다른 매핑과 겹치거나 메모리가 없으면 false. */
+bool
+vm_map_range (void *addr, size_t length, enum vm_type type, bool writable,
+		struct file *file, off_t offset, size_t read_bytes) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	void *end = addr + ROUND_UP(length, PGSIZE);
+	bool occupied = false;
+	struct vma *vma;
+
+	ASSERT(pg_ofs(addr) == 0);
+
+	if (length == 0 || end <= addr || !is_user_vaddr(end - 1)
+			|| vma_overlaps(&spt->vmas, addr, end))
+		return false;
+	/* VMA 밖에서 따로 만든 페이지(스택)와도 겹치면 안 된다 */
+	page_index_foreach(&spt->pages, addr, end, spt_mark_occupied, &occupied);
+	if (occupied)
+		return false;
+
+	vma = (struct vma *)malloc(sizeof(struct vma));
+	if (vma == NULL)
+		return false;
+	vma->start = addr;
+	vma->end = end;
+	vma->type = type;
+	vma->writable = writable;
+	vma->file = file;
+	vma->offset = offset;
+	vma->read_bytes = read_bytes;
+	vma_insert(&spt->vmas, vma);
+	return true;
+}
+
+/** #VMA ADDR에서 시작하는 VMA와 그 안에서 만들어진 페이지들을 없앤다. 수정된 파일 페이지는 destroy가 되돌려 쓴다 */
+void
+vm_unmap_range (void *addr) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vma *vma = vma_find(&spt->vmas, addr);
+
+	if (vma == NULL || vma->start != addr)
+		return;
+
+	page_index_foreach(&spt->pages, vma->start, vma->end, spt_destroy_page, spt);
+	vma_remove(&spt->vmas, vma);
+	file_close(vma->file);
+	free(vma);
+}
+
+/** #VMA VMA 안의 VA에 대한 페이지 객체를 UNINIT 상태로 만들어 spt에 넣는다.
+ *  파일에서 읽을 페이지라면 이 때에야 lazy_load_segment()에 넘길 aux를 만든다. */
+static struct page *
+spt_materialize (struct supplemental_page_table *spt, struct vma *vma, void *va) {
+	size_t ofs = va - vma->start;
+	struct aux *aux = NULL;
+	struct page *page;
+
+	if (vma->file != NULL) {
+		aux = (struct aux *)malloc(sizeof(struct aux));
+		if (aux == NULL)
+			return NULL;
+		aux->file = vma->file;
+		aux->offset = vma->offset + ofs;
+		aux->page_read_bytes = ofs >= vma->read_bytes ? 0
+				: vma->read_bytes - ofs < PGSIZE ? vma->read_bytes - ofs : PGSIZE;
+	}
+
+	page = page_new(vma->type, va, vma->writable, vma->file != NULL ? lazy_load_segment : NULL, aux);
+	if (page == NULL || !page_index_insert(&spt->pages, page)) {
+		free(page);
+		free(aux);
+		return NULL;
+	}
+	page->owner = spt->owner;
+	return page;
 }
 
 /* Find VA from spt and return page. On error, return NULL. */
@@ -107,12 +307,37 @@ spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
       있으면? 해당 hash_elem을 &로, 참조해서 해당 페이지 반환.
 	  없으면... NULL 반환
 	 */
-	struct page *page = (struct page *)malloc(sizeof(struct page)); // 가상 주소에 대응하는 해시 값 도출을 위해 새로운 페이지 할당
-	page->va = pg_round_down(va); // 가상 주소의 시작 주소를 페이지의 va에 복제
-	struct hash_elem *e = hash_find(&spt->spt_hash, &page->hash_elem); // spt hash 테이블에서 hash_elem과 같은 hash를 갖는 페이지를 찾아서 return
-	free(page); // 복제한 페이지 삭제
+	/** #VMA 이미 만들어진 페이지만 찾는다. VMA 안이라도 아직 만들지 않은 페이지는 NULL */
+	return page_index_lookup(&spt->pages, pg_round_down(va));
+}
 
-	return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
+/** #VMA VA의 페이지를 찾고, 없으면 VA를 포함하는 VMA에서 페이지 객체를 만든다.
+ *  실제로 페이지가 필요한 fault 경로에서만 쓴다. VMA 밖이거나 메모리가 없으면 NULL. */
+struct page *
+spt_get_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page;
+	struct vma *vma;
+
+	va = pg_round_down(va);
+	page = page_index_lookup(&spt->pages, va);
+	if (page != NULL)
+		return page;
+
+	vma = vma_find(&spt->vmas, va);
+	return vma != NULL ? spt_materialize(spt, vma, va) : NULL;
+}
+
+/** #VMA VA가 이미 만들어진 페이지(스택 등)이거나 VMA 안에 있으면 true. WRITABLE이면 쓰기 가능한지도 본다.
+ *  페이지 객체는 만들지 않으므로 시스템 콜 인자 검사에 쓴다. */
+bool
+spt_is_mapped (struct supplemental_page_table *spt, void *va, bool writable) {
+	struct page *page = spt_find_page(spt, va);
+	struct vma *vma;
+
+	if (page != NULL)
+		return !writable || page->writable;
+	vma = vma_find(&spt->vmas, va);
+	return vma != NULL && (!writable || vma->writable);
 }
 
 /* Insert PAGE into spt with validation. */
@@ -131,48 +356,229 @@ spt_insert_page (struct supplemental_page_table *spt UNUSED,
 	(결론) 성공 결과를 반환한다.
 	 */
 
-	return hash_insert(&spt->spt_hash, &page->hash_elem) ? false : true;
+	if (page_index_lookup(&spt->pages, page->va) != NULL)
+		return false;
+	return page_index_insert(&spt->pages, page);
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
-	hash_delete(&thread_current()->spt.spt_hash, &page->hash_elem); // *** extra
+	page_index_remove(&spt->pages, page->va);
 	vm_dealloc_page (page);
-	return true;
+}
+
+/** #VMA page_index_foreach()용. 페이지를 spt에서 빼고 해제한다 */
+static void
+spt_destroy_page (struct page *page, void *spt) {
+	spt_remove_page(spt, page);
+}
+
+/** #VMA page_index_foreach()용. 페이지가 하나라도 있으면 *OCCUPIED를 true로 */
+static void
+spt_mark_occupied (struct page *page UNUSED, void *occupied) {
+	*(bool *)occupied = true;
 }
 
 /* Get the struct frame, that will be evicted. */
+/** Project 3: Memory Management 모든 프로세스의 frame을 대상으로 하는 clock 알고리즘.
+ *  hand는 호출 사이에 유지되며, 최근에 접근된 frame은 accessed bit를 지우고 한 바퀴 더 기회를 준다.
+ *  두 바퀴를 돌면 모든 accessed bit가 지워지므로 내보낼 수 있는 frame이 있다면 반드시 찾는다.
+ *  frame_table_lock을 잡은 채로 호출해야 한다. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
-	struct thread *curr = thread_current();
 
-	struct list_elem *e = list_begin(&frame_table);
-	for (e; e != list_end(&frame_table); e = list_next(e)) {
-		victim = list_entry(e, struct frame, frame_elem);
-		if (pml4_is_accessed(curr->pml4, victim->page->va))
-			pml4_set_accessed(curr->pml4, victim->page->va, false);
-		else
-			return victim;
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+	/** #Frame Table 배열을 주소 순으로 훑는다 */
+	for (size_t i = 0; i < 2 * frame_table_size; i++) {
+		struct frame *frame = &frame_table[clock_hand];
+
+		if (++clock_hand == frame_table_size)
+			clock_hand = 0;
+
+		/* 사용자 페이지가 아니거나, 아직 페이지가 연결되지 않았거나 내용을 채우는 중인 frame은 제외.
+		 * 공유 중인 frame은 swap_out()이 frame->pages의 mapping을 모두 지우고 내보낸다 */
+		if (!frame->used || frame->page == NULL || frame->pinned)
+			continue;
+
+		if (!vm_frame_accessed(frame)) {
+			victim = frame;
+			break;
+		}
+	}
+
+	/* 내보낸 뒤에는 다른 페이지가 쓰므로 더 이상 공유할 수 없다 */
+	if (victim != NULL)
+		text_cache_remove(victim);
+	return victim;
+}
+
+/** Project 3: Memory Management FRAME을 매핑한 모든 (pml4, va) 중 하나라도 접근되었으면 true.
+ *  검사하면서 accessed bit를 지운다. */
+static bool
+vm_frame_accessed (struct frame *frame) {
+	bool accessed = false;
+	struct list_elem *e;
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, share_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4 != NULL && pml4_is_accessed(pml4, page->va)) {
+			/** #Huge Page 2 MB 페이지의 accessed bit는 PDE 하나뿐이라 512 frame이 함께 본다.
+			 *  clock은 주소 순으로 훑으므로 마지막 frame에서만 지워 2 MB가 한 단위로 나이를 먹게 한다 */
+			if (!pml4_is_huge(pml4, page->va) || pg_no(page->va) % HUGE_PAGES == HUGE_PAGES - 1)
+				pml4_set_accessed(pml4, page->va, false);
+			accessed = true;
+		}
 	}
-	return list_entry(list_begin(&frame_table), struct frame, frame_elem);
+	return accessed;
+}
+
+/** #Frame Table KVA에 있는 user pool 페이지의 frame */
+static struct frame *
+vm_frame_lookup (void *kva) {
+	size_t idx = (kva - frame_base) / PGSIZE;
+
+	ASSERT(idx < frame_table_size);
+	return &frame_table[idx];
+}
+
+/** Project 3: Memory Management FRAME을 frame_table에서 뺀다. 물리 페이지는 호출자가 돌려준다.
+ *  vm_frame_table_acquire()로 frame_table_lock을 잡은 채로 호출해야 한다. */
+void
+vm_frame_remove (struct frame *frame) {
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+	frame_table_remove(frame);
+}
+
+/** #Frame Table destroy 경로가 페이지의 frame과 swap slot을 읽기 전에 잡는다.
+ *  reclaim은 이 lock을 잡은 채로 페이지를 내보내므로, 잡고 나면 내보내는 도중인 페이지는 없다. */
+void
+vm_frame_table_acquire (void) {
+	lock_acquire(&frame_table_lock);
+}
+
+void
+vm_frame_table_release (void) {
+	lock_release(&frame_table_lock);
+}
+
+/** #Frame Table 방금 user pool에서 받은 KVA의 frame을 사용 중으로 표시하고 pinned 상태로 반환한다.
+ *  이전에 쓰던 값이 남아 있으므로 clock이 보기 전에 page와 pinned부터 정리한다. */
+static struct frame *
+frame_table_insert (void *kva) {
+	struct frame *frame = vm_frame_lookup(kva);
+
+	lock_acquire(&frame_table_lock);
+	ASSERT(!frame->used);
+	frame->page = NULL;
+	frame->pinned = true;
+	frame->used = true;
+	lock_release(&frame_table_lock);
+	return frame;
+}
+
+static void
+frame_table_remove (struct frame *frame) {
+	text_cache_remove(frame);
+	frame->used = false;
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim (); // 제거할 프레임을 선택하는 함수 vm_get_victim ^
+	struct frame *victim UNUSED;
 	/* TODO: swap out the victim and return the evicted frame. */
 	/* Pseudo code: 선언했던 frame_table에서, 제일 앞에 있는 frame 주소를 반환? */
-	
-	if (victim->page) // 해당 프레임에 페이지가 연결되어 있다면 swap_out을 시킨다. - 디스크의 swap 영역으로 보내는 함수.
-		swap_out(victim->page);
 
+	/* swap out이 끝날 때까지 frame_table_lock을 잡아, 그 사이 소유자가 frame을 해제하지 못하게 한다 */
+	lock_acquire(&frame_table_lock);
+	victim = vm_get_victim (); // 제거할 프레임을 선택하는 함수 vm_get_victim ^
+	if (victim != NULL && !swap_out(victim->page)) // 디스크의 swap 영역으로 보내는 함수.
+		victim = NULL;
+	lock_release(&frame_table_lock);
+
+	if (victim != NULL)
+		direct_reclaim_cnt++;
 	return victim;
 }
 
+/** Project 3: Page Reclaim victim을 최대 SWAP_CLUSTER개 골라 내보내고 frame을 user pool에 돌려준다.
+ *  #Clustered Swap 익명 페이지들은 anon_swap_out_cluster()로 연속된 slot에 한 번에 쓰고,
+ *  연속된 slot이 없을 때만 하나씩 내보낸다. 돌려준 frame 수를 반환한다. */
+static size_t
+vm_reclaim_frames (void) {
+	struct frame *victims[SWAP_CLUSTER];
+	struct page *anon_pages[SWAP_CLUSTER];
+	size_t victim_cnt = 0, anon_cnt = 0, freed = 0;
+	struct frame *victim;
+	size_t i;
+
+	lock_acquire(&frame_table_lock);
+	/* 고른 frame은 pin해서 다음 vm_get_victim()이 다시 고르지 않게 한다 */
+	while (victim_cnt < SWAP_CLUSTER && (victim = vm_get_victim()) != NULL) {
+		victim->pinned = true;
+		victims[victim_cnt++] = victim;
+	}
+
+	for (i = 0; i < victim_cnt; i++) {
+		struct page *page = victims[i]->page;
+
+		/* 공유 중이거나 버릴 실행 파일 페이지는 묶지 않고 swap_out()이 따로 처리한다 */
+		if (page_get_type(page) == VM_ANON && victims[i]->ref_cnt == 1
+				&& page->anon.text_inode == NULL)
+			anon_pages[anon_cnt++] = page;
+		else
+			swap_out(page);
+	}
+	if (anon_cnt > 0 && !anon_swap_out_cluster(anon_pages, anon_cnt))
+		for (i = 0; i < anon_cnt; i++)
+			if (anon_pages[i]->frame != NULL)
+				swap_out(anon_pages[i]);
+
+	/* swap out에 성공한 frame은 page가 NULL이 된다 */
+	for (i = 0; i < victim_cnt; i++) {
+		victims[i]->pinned = false;
+		if (victims[i]->page == NULL) {
+			frame_table_remove(victims[i]);
+			victims[freed++] = victims[i];
+		}
+	}
+	lock_release(&frame_table_lock);
+
+	for (i = 0; i < freed; i++)
+		palloc_free_page(victims[i]->kva);
+	return freed;
+}
+
+/** Project 3: Page Reclaim reclaim 스레드. free frame이 low watermark 아래로 내려가 깨워지면
+ *  high watermark가 될 때까지 frame을 내보낸다. 묶음마다 frame_table_lock을 놓으므로
+ *  fault 경로는 많아야 한 묶음을 쓰는 동안만 기다린다. */
+static void
+vm_reclaim_daemon (void *aux UNUSED) {
+	size_t freed;
+
+	for (;;) {
+		sema_down(&reclaim_sema);
+		reclaim_wakeups++;
+		while (palloc_free_cnt(PAL_USER) < reclaim_high && (freed = vm_reclaim_frames()) > 0)
+			reclaim_cnt += freed;
+		reclaim_running = false;
+	}
+}
+
+/** Project 3: Page Reclaim free frame이 low watermark 아래면 reclaim 스레드를 깨운다 */
+static void
+vm_reclaim_wakeup (void) {
+	if (!reclaim_running && palloc_free_cnt(PAL_USER) < reclaim_low) {
+		reclaim_running = true;
+		sema_up(&reclaim_sema);
+	}
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
@@ -193,19 +599,62 @@ vm_get_frame (void) {
 	 * (남아있다면) lazy_load_segment를 호출하면 되는거 아닌가? 
 	 * (남아있지 않다면) vm_evict_frame을 호출하고, lazy_load_segment */
 
-	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
-	ASSERT(frame != NULL);
-	
-	frame->kva = palloc_get_page(PAL_USER | PAL_ZERO); // 유저 풀(PM)에서 페이지를 할당 받음. 또한, 할당 받은 페이지를 0으로 선언.
+	struct frame *frame;
+	void *kva = palloc_get_page(PAL_USER | PAL_ZERO); // 유저 풀(PM)에서 페이지를 할당 받음. 또한, 할당 받은 페이지를 0으로 선언.
 
-	if (frame->kva == NULL)
+	if (kva == NULL) {
 		frame = vm_evict_frame(); // swap out 실행
-	else
-		list_push_back(&frame_table, &frame->frame_elem); // frame 구조체에 frame_elem 추가.
+		if (frame == NULL)
+			PANIC("vm_get_frame: no frame to evict");
+	} else
+		frame = frame_table_insert(kva); // 미리 만들어 둔 frame_table에서 kva의 frame을 찾음.
 	
 	frame->page = NULL; // 현 시점에는, 아직 page랑 연결된 게 아니므로, 명시적으로 NULL을 넣어주어 이를 표현해준다.
 	ASSERT (frame->page == NULL);
 
+	/** Project 3: Copy On Write (Extra) */
+	list_init(&frame->pages);
+	frame->ref_cnt = 0;
+
+	/** Project 3: Page Reclaim 호출자가 내용을 채우고 풀어줄 때까지 내보내지 않는다 */
+	frame->pinned = true;
+	frame->text_inode = NULL;
+	vm_reclaim_wakeup();
+
+	return frame;
+}
+
+/** #Clustered Swap 미리 읽어 올 PAGE에 새 frame을 붙이고 소유자의 pml4에 매핑한다.
+ *  free frame이 low watermark 이하라면 다른 frame을 내보내면서까지 미리 읽지 않고 NULL을 반환한다.
+ *  반환된 frame은 pinned 상태이다. */
+struct frame *
+vm_frame_prefetch (struct page *page) {
+	struct frame *frame;
+	void *kva;
+
+	if (palloc_free_cnt(PAL_USER) <= reclaim_low)
+		return NULL;
+	kva = palloc_get_page(PAL_USER);
+	if (kva == NULL)
+		return NULL;
+
+	frame = frame_table_insert(kva);
+	frame->page = NULL;
+	list_init(&frame->pages);
+	frame->ref_cnt = 0;
+	frame->pinned = true;
+	frame->text_inode = NULL;
+
+	vm_frame_link(frame, page);
+	if (!pml4_set_page(page->owner->pml4, page->va, kva, page->writable)) {
+		lock_acquire(&frame_table_lock);
+		list_remove(&page->share_elem);
+		frame_table_remove(frame);
+		lock_release(&frame_table_lock);
+		page->frame = NULL;
+		palloc_free_page(kva);
+		return NULL;
+	}
 	return frame;
 }
 
@@ -224,18 +673,127 @@ vm_stack_growth (void *addr UNUSED) {
 }
 
 /* Handle the fault on write_protected page */
+/** Project 3: Copy On Write (Extra) fork 후 공유 중인 frame에 처음 쓸 때 이 페이지만 새 frame으로 복사한다.
+ *  마지막으로 남은 페이지라면 복사 없이 쓰기 권한만 되돌린다. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct frame *old_frame;
+	struct frame *frame;
+
+	/* 원래 쓸 수 없는 페이지에 쓰려고 한 경우 */
+	if (page == NULL || !page->writable || page->frame == NULL)
+		return false;
+
+	old_frame = page->frame;
+	if (old_frame->ref_cnt == 1) {
+		pml4_set_writable(thread_current()->pml4, page->va, true);
+		return true;
+	}
+
+	/* vm_get_frame()은 eviction 때문에 block할 수 있으므로, 그 사이 다른 공유자가 끝나 ref_cnt가 1이 되었거나
+	 * 공유 frame이 내보내졌을 수 있다. frame_table_lock을 잡고 다시 확인한다 */
+	frame = vm_get_frame();
+	lock_acquire(&frame_table_lock);
+	if (page->frame != old_frame || old_frame->ref_cnt == 1) {
+		/* 내보내졌다면 다시 fault가 나서 swap in한다 */
+		if (page->frame == old_frame)
+			pml4_set_writable(thread_current()->pml4, page->va, true);
+		frame_table_remove(frame);
+		lock_release(&frame_table_lock);
+		palloc_free_page(frame->kva);
+		return true;
+	}
+	memcpy(frame->kva, old_frame->kva, PGSIZE);
+	vm_frame_unlink(page);
+	frame_link_locked(frame, page);
+	lock_release(&frame_table_lock);
+	frame->pinned = false;
+
+	return pml4_set_page(thread_current()->pml4, page->va, frame->kva, true);
+}
+
+/** Project 3: Copy On Write (Extra) PAGE를 FRAME에 연결한다. 이미 연결된 페이지가 있으면 함께 공유한다. */
+static void
+vm_frame_link (struct frame *frame, struct page *page) {
+	lock_acquire(&frame_table_lock);
+	frame_link_locked(frame, page);
+	lock_release(&frame_table_lock);
+}
+
+static void
+frame_link_locked (struct frame *frame, struct page *page) {
+	page->frame = frame;
+	list_push_back(&frame->pages, &page->share_elem);
+	frame->ref_cnt++;
+	if (frame->page == NULL)
+		frame->page = page;
+}
+
+/** Project 3: Copy On Write (Extra) 공유 중인 frame에서 PAGE만 떼어낸다.
+ *  frame은 남은 페이지들이 계속 사용한다. clock이 frame->pages를 훑을 수 있으므로
+ *  frame_table_lock을 잡은 채로 호출해야 한다. */
+void
+vm_frame_unlink (struct page *page) {
+	struct frame *frame = page->frame;
+
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+	ASSERT(frame != NULL && frame->ref_cnt > 1);
+
+	list_remove(&page->share_elem);
+	frame->ref_cnt--;
+	if (frame->page == page)
+		frame->page = list_empty(&frame->pages) ? NULL
+				: list_entry(list_front(&frame->pages), struct page, share_elem);
+	page->frame = NULL;
+}
+
+/** #Shared Eviction FRAME을 매핑한 모든 페이지의 mapping을 지운다. 하나라도 dirty였으면 true.
+ *  frame_table_lock을 잡은 채로 호출해야 한다. */
+bool
+vm_frame_unmap (struct frame *frame) {
+	bool dirty = false;
+	struct list_elem *e;
+
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	for (e = list_begin(&frame->pages); e != list_end(&frame->pages); e = list_next(e)) {
+		struct page *page = list_entry(e, struct page, share_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4 == NULL)
+			continue;
+		if (pml4_is_dirty(pml4, page->va))
+			dirty = true;
+		pml4_clear_page(pml4, page->va);
+	}
+	return dirty;
+}
+
+/** #Shared Eviction 내보낸 FRAME에서 연결된 페이지를 모두 떼어낸다. frame->page가 NULL이 된다.
+ *  frame_table_lock을 잡은 채로 호출해야 한다. */
+void
+vm_frame_detach (struct frame *frame) {
+	ASSERT(lock_held_by_current_thread(&frame_table_lock));
+
+	while (!list_empty(&frame->pages)) {
+		struct page *page = list_entry(list_pop_front(&frame->pages), struct page, share_elem);
+
+		page->frame = NULL;
+	}
+	frame->ref_cnt = 0;
+	frame->page = NULL;
 }
 
 /** Project 3: Memory Management - Return true on success */
 bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED, bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
     struct supplemental_page_table *spt UNUSED = &thread_current()->spt;
-    struct page *page = spt_find_page(&thread_current()->spt, addr);
+    struct page *page;
 
     /* TODO: Validate the fault */
+    /** #VMA 커널 주소로 spt를 찾거나 VMA에서 페이지를 만들지 않도록 먼저 검사한다 */
     if (addr == NULL || is_kernel_vaddr(addr))
         return false;
+    page = spt_get_page(&thread_current()->spt, addr);
 
     /** Project 3: Copy On Write (Extra) - 접근한 메모리의 page가 존재하고 write 요청인데 write protected인 경우라 발생한 fault일 경우*/
     if (!not_present && write)
@@ -257,7 +815,288 @@ bool vm_try_handle_fault(struct intr_frame *f UNUSED, void *addr UNUSED, bool us
         return false;
     }
 
-    return vm_do_claim_page(page);  // demand page 수행
+    /** Project 3: Page Reclaim 내보내는 중인 페이지라면 swap out이 끝날 때까지 기다린다 */
+    if (page->frame != NULL) {
+        lock_acquire(&frame_table_lock);
+        lock_release(&frame_table_lock);
+        if (page->frame != NULL)
+            return false;
+    }
+
+    /** #Huge Page 주변 2 MB가 모두 아직 건드리지 않은 익명 페이지에 쓰면 한 번에 채운다.
+     *  읽기만 하면 아래에서 zero frame을 매핑하므로 2 MB를 미리 잡지 않는다 */
+    if (write && vm_zero_fillable(page) && vm_map_huge(page))
+        return true;
+
+    /** #Zero Page 아직 쓰지 않은 익명 페이지를 읽기만 하면 공유 zero frame을 매핑한다 */
+    if (!write && vm_zero_fillable(page))
+        return vm_map_zero_page(page);
+
+    /** #Shared Text 다른 프로세스가 이미 읽어 둔 읽기 전용 실행 파일 페이지면 그 frame을 공유한다 */
+    struct frame key;
+    bool text = vm_text_key(page, &key);
+    if (text && vm_map_text_page(page, &key))
+        return true;
+
+    /** #Fault Around 파일에서 읽는 페이지였다면 이어지는 페이지들도 미리 채운다 */
+    struct file *file = vm_page_file(page);
+    if (!vm_do_claim_page(page))  // demand page 수행
+        return false;
+    if (text)
+        vm_text_cache_insert(page, &key);
+    if (file != NULL)
+        vm_fault_around(page, file);
+    return true;
+}
+
+/** #Zero Page PAGE가 0으로만 채워질 아직 초기화되지 않은 익명 페이지(스택, BSS)이면 true */
+static bool
+vm_zero_fillable (struct page *page) {
+	struct aux *aux = page->uninit.aux;
+
+	if (page->operations->type != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON)
+		return false;
+	if (page->uninit.init == NULL)
+		return true;
+	return page->uninit.init == lazy_load_segment && aux->page_read_bytes == 0;
+}
+
+/** #Huge Page PAGE를 포함한 2 MB 구간이 쓰기 가능한 익명 VMA 안에 있고, 파일에서 읽을 바이트가 없고,
+ *  PAGE 말고는 만들어진 페이지가 없으면 연속된 2 MB frame을 받아 2 MB 페이지로 매핑한다.
+ *  free frame이 넉넉하지 않거나 조건이 맞지 않으면 false이고, 호출자는 4 KB로 처리한다. */
+static bool
+vm_map_huge (struct page *page) {
+	struct thread *t = thread_current();
+	struct supplemental_page_table *spt = &t->spt;
+	void *base = (void *) ((uint64_t) page->va & ~(PGSIZE_2M - 1));
+	void *end = base + PGSIZE_2M;
+	struct vma *vma = vma_find(&spt->vmas, page->va);
+	size_t cnt = 0;
+	void *kva, *va;
+
+	if (vma == NULL || VM_TYPE(vma->type) != VM_ANON || !vma->writable
+			|| base < vma->start || end > vma->end
+			|| (size_t) (base - vma->start) < vma->read_bytes)
+		return false;
+	page_index_foreach(&spt->pages, base, end, huge_count_page, &cnt);
+	if (cnt != 1 || palloc_free_cnt(PAL_USER) < HUGE_PAGES + reclaim_high)
+		return false;
+
+	kva = palloc_get_aligned(PAL_USER | PAL_ZERO, HUGE_PAGES);
+	if (kva == NULL)
+		return false;
+
+	/* 먼저 페이지 객체를 모두 만든다. 실패해도 만든 UNINIT 페이지는 그대로 쓸 수 있다 */
+	for (va = base; va < end; va += PGSIZE)
+		if (spt_get_page(spt, va) == NULL)
+			goto fail;
+	if (!pml4_set_huge(t->pml4, base, kva, true))
+		goto fail;
+
+	for (va = base; va < end; va += PGSIZE) {
+		struct page *p = page_index_lookup(&spt->pages, va);
+		struct frame *frame = frame_table_insert(kva + (va - base));
+		void *aux = p->uninit.aux;
+
+		list_init(&frame->pages);
+		frame->ref_cnt = 0;
+		frame->text_inode = NULL;
+		vm_frame_link(frame, p);
+		p->uninit.page_initializer(p, p->uninit.type, frame->kva);
+		free(aux);
+		frame->pinned = false;
+	}
+	huge_cnt++;
+	return true;
+
+fail:
+	palloc_free_multiple(kva, HUGE_PAGES);
+	return false;
+}
+
+/** #Huge Page page_index_foreach()용. 만들어진 페이지 수를 센다 */
+static void
+huge_count_page (struct page *page UNUSED, void *cnt) {
+	(*(size_t *) cnt)++;
+}
+
+/** #Zero Page PAGE를 frame 없이 익명 페이지로 초기화하고 zero frame에 읽기 전용으로 매핑한다 */
+static bool
+vm_map_zero_page (struct page *page) {
+	void *aux = page->uninit.aux;
+	bool success = page->uninit.page_initializer(page, page->uninit.type, NULL);
+
+	free(aux);
+	if (!success)
+		return false;
+
+	vm_frame_link(&zero_frame, page);
+	return pml4_set_page(thread_current()->pml4, page->va, zero_frame.kva, false);
+}
+
+/** #Shared Text PAGE가 아직 읽지 않은 읽기 전용 실행 파일 segment 페이지면 캐시 key를 KEY에 채우고 true.
+ *  읽어 온 뒤에는 aux가 사라지므로 key는 읽기 전에 만들어 둔다.
+ *  내보내면서 버린 페이지는 기억해 둔 위치로 다시 찾는다. */
+static bool
+vm_text_key (struct page *page, struct frame *key) {
+	struct aux *aux = page->uninit.aux;
+
+	if (page->operations->type == VM_ANON && page->anon.text_inode != NULL) {
+		key->text_inode = page->anon.text_inode;
+		key->text_ofs = page->anon.text_ofs;
+		key->text_bytes = page->anon.text_bytes;
+		return true;
+	}
+	if (page->operations->type != VM_UNINIT || VM_TYPE(page->uninit.type) != VM_ANON
+			|| page->writable || page->uninit.init != lazy_load_segment
+			|| aux->page_read_bytes == 0)
+		return false;
+
+	key->text_inode = file_get_inode(aux->file);
+	key->text_ofs = aux->offset;
+	key->text_bytes = aux->page_read_bytes;
+	return true;
+}
+
+/** #Shared Text KEY의 frame이 캐시에 있으면 PAGE를 익명 페이지로 초기화하고
+ *  그 frame에 읽기 전용으로 매핑한다. 캐시에 없으면 false. */
+static bool
+vm_map_text_page (struct page *page, struct frame *key) {
+	struct hash_elem *e;
+	struct frame *frame = NULL;
+	bool uninit = page->operations->type == VM_UNINIT;
+	void *aux = page->uninit.aux;
+
+	/* 찾은 frame이 그 사이 해제되지 않도록 같은 락 안에서 연결한다.
+	 * clock이 frame->pages의 페이지를 내보낼 수 있으므로 초기화도 연결하기 전에 마친다 */
+	lock_acquire(&frame_table_lock);
+	e = hash_find(&text_cache, &key->text_elem);
+	if (e != NULL) {
+		frame = hash_entry(e, struct frame, text_elem);
+		if (uninit)
+			page->uninit.page_initializer(page, page->uninit.type, frame->kva);
+		text_page_set_source(page, key);
+		frame_link_locked(frame, page);
+	}
+	lock_release(&frame_table_lock);
+	if (frame == NULL)
+		return false;
+
+	if (uninit)
+		free(aux);
+	return pml4_set_page(thread_current()->pml4, page->va, frame->kva, false);
+}
+
+/** #Shared Text PAGE가 KEY 위치에서 읽은 내용임을 기록해, 내보낼 때 쓰지 않고 버리게 한다 */
+static void
+text_page_set_source (struct page *page, struct frame *key) {
+	page->anon.text_inode = key->text_inode;
+	page->anon.text_ofs = key->text_ofs;
+	page->anon.text_bytes = key->text_bytes;
+}
+
+/** #Shared Text 방금 KEY의 내용을 읽어 온 페이지 PAGE의 frame을 캐시에 넣는다 */
+static void
+vm_text_cache_insert (struct page *page, struct frame *key) {
+	struct frame *frame;
+
+	lock_acquire(&frame_table_lock);
+	frame = page->frame;
+	/* 그 사이 내보내졌을 수 있다 */
+	if (frame != NULL)
+		text_page_set_source(page, key);
+	if (frame != NULL && frame->text_inode == NULL) {
+		frame->text_inode = key->text_inode;
+		frame->text_ofs = key->text_ofs;
+		frame->text_bytes = key->text_bytes;
+		if (hash_insert(&text_cache, &frame->text_elem) != NULL)
+			frame->text_inode = NULL;  // 다른 프로세스가 먼저 넣었다
+	}
+	lock_release(&frame_table_lock);
+}
+
+static void
+text_cache_remove (struct frame *frame) {
+	if (frame->text_inode != NULL) {
+		hash_delete(&text_cache, &frame->text_elem);
+		frame->text_inode = NULL;
+	}
+}
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry(e, struct frame, text_elem);
+
+	return hash_bytes(&f->text_inode, sizeof f->text_inode)
+		^ hash_int(f->text_ofs) ^ hash_int(f->text_bytes);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED) {
+	const struct frame *a = hash_entry(a_, struct frame, text_elem);
+	const struct frame *b = hash_entry(b_, struct frame, text_elem);
+
+	if (a->text_inode != b->text_inode)
+		return a->text_inode < b->text_inode;
+	if (a->text_ofs != b->text_ofs)
+		return a->text_ofs < b->text_ofs;
+	return a->text_bytes < b->text_bytes;
+}
+
+/** #Fault Around frame이 없는 PAGE가 파일에서 내용을 읽어 올 페이지라면 그 파일, 아니면 NULL.
+ *  lazy loading될 실행 파일 segment와 mmap 페이지가 해당된다. */
+static struct file *
+vm_page_file (struct page *page) {
+	if (page->operations->type == VM_UNINIT) {
+		struct aux *aux = page->uninit.aux;
+
+		if (page->uninit.init != lazy_load_segment || aux->page_read_bytes == 0)
+			return NULL;
+		return aux->file;
+	}
+	if (page->operations->type == VM_FILE)
+		return page->file.file;
+	return NULL;
+}
+
+/** #Fault Around 방금 채운 PAGE 뒤로 FILE에서 읽어 올 페이지들을 창 크기만큼 미리 채운다.
+ *  fault가 직전 창의 바로 다음에서 나면 순차 접근으로 보고 창을 두 배로 늘리고(최대 fault_around_pages),
+ *  아니면 FAULT_AROUND_MIN으로 줄인다. free frame이 부족하면 다른 frame을 내보내면서까지 채우지 않는다. */
+static void
+vm_fault_around (struct page *page, struct file *file) {
+	struct thread *t = thread_current();
+	struct frame key;
+	bool text;
+	size_t i;
+
+	if (page->va == t->fault_around_next)
+		t->fault_around_window *= 2;
+	else
+		t->fault_around_window = FAULT_AROUND_MIN;
+	if (t->fault_around_window > fault_around_pages)
+		t->fault_around_window = fault_around_pages;
+
+	for (i = 1; i < t->fault_around_window; i++) {
+		struct page *next = spt_get_page(&t->spt, page->va + i * PGSIZE);
+		struct frame *frame;
+		bool success;
+
+		if (next == NULL || next->frame != NULL || vm_page_file(next) != file)
+			break;
+		text = vm_text_key(next, &key);
+		if (text && vm_map_text_page(next, &key))
+			continue;
+		frame = vm_frame_prefetch(next);
+		if (frame == NULL)
+			break;
+		success = swap_in(next, frame->kva);
+		frame->pinned = false;
+		if (!success)
+			break;
+		if (text)
+			vm_text_cache_insert(next, &key);
+	}
+	t->fault_around_next = page->va + i * PGSIZE;
 }
 
 /* Free the page.
@@ -281,7 +1120,7 @@ bool vm_claim_page(void *va UNUSED) {
 	 * va에서 외부 구조체로 page에 접근한 후; 프레임과 연결..?
 	 * 연결을 어떤 변수에다가 해야하지? */
 
-    struct page *page = spt_find_page(&thread_current()->spt, va); // va로 spt에서 va에 해당하는 페이지를 찾고,
+    struct page *page = spt_get_page(&thread_current()->spt, va); // va로 spt에서 va에 해당하는 페이지를 찾고,
 
     if (page == NULL) // spt에 va에 해당하는 페이지가 할당되어 있지 않다면 false 반환
         return false;
@@ -294,15 +1133,18 @@ static bool vm_do_claim_page(struct page *page) {
     struct frame *frame = vm_get_frame(); // vm_get_frame으로 새로 값을 할당할 frame을 PM에서 찾기.
 
     /* Set links */
-    frame->page = page; // 해당 프레임의 페이지를 현재 페이지로 mapping하고
-    page->frame = frame; // 현재 페이지의 프레임을 새로 할당한 프레임과 mapping 시켜준다.
+    vm_frame_link(frame, page); // 프레임과 현재 페이지를 서로 연결
 
     /* TODO: Insert page table entry to map page's VA to frame's PA. */
 	// page table entry - VA를 PA와 매핑이 성공되었다면, true가 반환되고, 실패했다면 false가 반환됨.;;
-    if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable))
+    if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable)) {
+        frame->pinned = false;
         return false;
+    }
 
-    return swap_in(page, frame->kva);  
+    bool success = swap_in(page, frame->kva);
+    frame->pinned = false;
+    return success;
 	/* uninit_initialize - swap_in 핸들러가 실행되며 uninit_initialize가 실행된다.
 	 * uninit_initialize에서 vm_alloc_page_with_initializer에서 설정한 초기화 함수가 실행됨.
 	 */ 
@@ -314,69 +1156,160 @@ supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	/* Pseudo
 	 * 아마도,,, virtual page entry 개수 만큼의 리스트 할당. 이를 통해 spt 초기화
 	 */
-	hash_init(&spt->spt_hash, hash_func, less_func, NULL);
+	vma_tree_init(&spt->vmas);
+	page_index_init(&spt->pages);
+	spt->owner = thread_current();
+}
+
+/** #VMA vma_foreach(), page_index_foreach()로 supplemental_page_table_copy()에 넘기는 상태 */
+struct spt_copy {
+	struct supplemental_page_table *dst;
+	bool success;
+};
+
+/** #VMA 부모의 VMA를 자식 spt에 복제한다. 파일은 따로 닫을 수 있도록 다시 연다 */
+static void
+spt_copy_vma (struct vma *src, void *copy_) {
+	struct spt_copy *copy = copy_;
+	struct vma *vma;
+
+	if (!copy->success)
+		return;
+	vma = (struct vma *)malloc(sizeof(struct vma));
+	if (vma == NULL)
+		goto err;
+	memcpy(vma, src, sizeof(struct vma));
+	if (src->file != NULL && (vma->file = file_reopen(src->file)) == NULL) {
+		free(vma);
+		goto err;
+	}
+	vma_insert(&copy->dst->vmas, vma);
+	return;
+
+err:
+	copy->success = false;
 }
 
+static void spt_copy_page (struct page *src_page, void *copy_);
+
 /* Copy supplemental page table from src to dst */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 		struct supplemental_page_table *src UNUSED) {
 	/* pseudo
 	 * spt를 순회하면서, UNINIT상태인지 확인
-	 * UNINIT상태라면, vm_do_claim_page를 eager로 함.
+	 * UNINIT상태라면, vm_alloc_page_with_initializer로 같은 초기화 정보를 가진 페이지를 만듦.
+	 * 이미 frame이 있는 ANON/FILE 페이지는 copy-on-write로 frame을 읽기 전용으로 공유함.
 	 */
 
-	struct hash_iterator iter;
+	struct spt_copy copy = { .dst = dst, .success = true };
+
+	vma_foreach(&src->vmas, spt_copy_vma, &copy);
+
+	/** #VMA 만들어진 페이지만 순회한다. 나머지는 자식이 처음 접근할 때 복제된 VMA에서 만든다 */
+	page_index_foreach(&src->pages, NULL, (void *) KERN_BASE, spt_copy_page, &copy);
+	return copy.success;
+}
+
+static void
+spt_copy_page (struct page *src_page, void *copy_) {
+	struct spt_copy *copy = copy_;
+	struct supplemental_page_table *dst = copy->dst;
 	struct page *dst_page;
+	struct thread *curr = thread_current();
+	enum vm_type type = src_page->operations->type;
+	void *upage = src_page->va;
+	bool writable = src_page->writable;
+	struct vma *vma;
 	struct aux *aux;
+	struct frame *frame;
+	bool mapped = false;
 
-	hash_first(&iter, &src->spt_hash);
+	if (!copy->success)
+		return;
 
-	while(hash_next(&iter)) { //spt 순환
-		struct page *src_page = hash_entry(hash_cur(&iter), struct page, hash_elem);
-		enum vm_type type = src_page->operations->type;
-		void *upage = src_page->va;
-		bool writable = src_page->writable;
-
-		switch (type) {
-			case VM_UNINIT: //vm_alloc_page_with_initializer로 새로운 spt에 페이지 할당.
-				if (!vm_alloc_page_with_initializer(page_get_type(src_page), upage, writable, src_page->uninit.init, src_page->uninit.aux))
-					goto err;
+	vma = vma_find(&dst->vmas, upage);
+	switch (type) {
+		case VM_UNINIT: //vm_alloc_page_with_initializer로 새로운 spt에 페이지 할당.
+			/** #VMA VMA 안의 페이지는 자식이 VMA에서 다시 만들면 된다 */
+			if (vma != NULL)
 				break;
-			case VM_FILE:
-				if(!vm_alloc_page_with_initializer(type, upage, writable, NULL, &src_page->file))
+			aux = src_page->uninit.aux;
+			if (aux != NULL) {
+				aux = (struct aux *)malloc(sizeof(struct aux));
+				if (aux == NULL)
 					goto err;
-				dst_page = spt_find_page(dst, upage);
-				if(!file_backed_initializer(dst_page, type, NULL))
+				memcpy(aux, src_page->uninit.aux, sizeof(struct aux));
+			}
+			if (!vm_alloc_page_with_initializer(page_get_type(src_page), upage, writable, src_page->uninit.init, aux)) {
+				free(aux);
+				goto err;
+			}
+			break;
+
+		case VM_ANON:
+		case VM_FILE:
+			/** Project 3: Copy On Write (Extra) 페이지 정보는 그대로 복사하고 frame은 공유 */
+			dst_page = (struct page *)malloc(sizeof(struct page));
+			if (dst_page == NULL)
+				goto err;
+			memcpy(dst_page, src_page, sizeof(struct page));
+			dst_page->owner = curr;
+			dst_page->frame = NULL;
+			if (type == VM_ANON) {
+				dst_page->anon.slot = BITMAP_ERROR;
+				dst_page->anon.zswap = NULL;
+			} else if (vma != NULL) {
+				/* 부모가 munmap해도 닫히지 않도록 자식의 VMA가 가진 파일을 쓴다 */
+				dst_page->file.file = vma->file;
+			}
+			if (!spt_insert_page(dst, dst_page)) {
+				free(dst_page);
+				goto err;
+			}
+
+			/* 공유 중인 frame도 내보낼 수 있으므로, frame을 확인하고 양쪽 mapping을 고칠 때까지 lock을 잡는다 */
+			lock_acquire(&frame_table_lock);
+			frame = src_page->frame;
+			if (frame != NULL) {
+				/* 부모와 자식 모두 읽기 전용으로 매핑하고, 먼저 쓰는 쪽이 vm_handle_wp()에서 복사 */
+				frame_link_locked(frame, dst_page);
+				if (writable)
+					pml4_set_writable(src_page->owner->pml4, upage, false);
+				mapped = pml4_set_page(curr->pml4, upage, frame->kva, false);
+			}
+			lock_release(&frame_table_lock);
+
+			if (frame != NULL) {
+				if (!mapped)
 					goto err;
-				
-				dst_page->frame = src_page->frame;
-				if(!pml4_set_page(thread_current()->pml4, dst_page->va, src_page->frame->kva, src_page->writable))
+			} else if (type == VM_ANON
+					&& (src_page->anon.slot != BITMAP_ERROR || src_page->anon.zswap != NULL)) {
+				/* swap out된 익명 페이지는 swap slot이나 압축 캐시를 공유하지 않고 바로 읽어 옴 */
+				frame = vm_get_frame();
+				vm_frame_link(frame, dst_page);
+				if (!pml4_set_page(curr->pml4, upage, frame->kva, writable))
 					goto err;
-				
-				break;
-			
-			case VM_ANON:
-				if(!vm_alloc_page(type, upage, writable))
+				if (!anon_swap_copy(src_page, frame->kva))
 					goto err;
-		
-				vm_claim_page(upage); // spt copy... ** added 
-            	struct page *dst_page = spt_find_page(dst,upage);
-            	memcpy(dst_page->frame->kva,src_page->frame->kva,PGSIZE);
-            	break;
-
-			
-			default:
-				goto err;
-		}
+				frame->pinned = false;
+			}
+			/* swap out된 파일 페이지는 자식이 처음 접근할 때 파일에서 다시 읽음 */
+			break;
 
+		default:
+			goto err;
 	}
-	return true;
+	return;
 
 err:
-	return false;
-
+	copy->success = false;
+}
 
+/** #VMA page_index_foreach()용. 페이지를 해제만 한다. 인덱스는 한꺼번에 비운다 */
+static void
+spt_kill_page (struct page *page, void *aux UNUSED) {
+	vm_dealloc_page(page);
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -386,5 +1319,19 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	 * TODO: writeback all the modified contents to the storage. */
 	/* pseudo:
 	 * thread에서 사용 중이라고 mark되어 있는 spt element를 찾고 이에 대해서, free를 해줌. */
-	hash_clear(&spt->spt_hash, hash_destructor); // hash_clear 함수 호출
+	struct vma *vma;
+	uint64_t *pml4 = thread_current()->pml4;
+
+	/** #Huge Page 페이지마다 mapping을 지우면 2 MB 페이지를 쪼개야 하므로 먼저 한꺼번에 지운다 */
+	if (pml4 != NULL)
+		pml4_clear_huge(pml4);
+	page_index_foreach(&spt->pages, NULL, (void *) KERN_BASE, spt_kill_page, NULL);
+	page_index_destroy(&spt->pages);
+
+	/* 수정된 파일 페이지를 되돌려 쓴 다음에 파일을 닫는다 */
+	while ((vma = spt->vmas.root) != NULL) {
+		vma_remove(&spt->vmas, vma);
+		file_close(vma->file);
+		free(vma);
+	}
 }
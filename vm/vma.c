@@ -0,0 +1,352 @@
+/* vma.c: Virtual memory areas and the per-process page index.
+ *
+ * A process's address space is described by VMAs kept in an AVL tree
+ * ordered by start address.  A struct page is created only when a
+ * page inside a VMA is first looked up, and is then kept in a radix
+ * tree indexed by virtual page number, so mapping a large range costs
+ * one VMA no matter how many pages it spans.
+ * */
+
+#include "vm/vma.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+static int
+vma_height (struct vma *v) {
+	return v != NULL ? v->height : 0;
+}
+
+static void
+vma_update (struct vma *v) {
+	int l = vma_height(v->left), r = vma_height(v->right);
+
+	v->height = 1 + (l > r ? l : r);
+}
+
+static struct vma *
+rotate_right (struct vma *v) {
+	struct vma *l = v->left;
+
+	v->left = l->right;
+	l->right = v;
+	vma_update(v);
+	vma_update(l);
+	return l;
+}
+
+static struct vma *
+rotate_left (struct vma *v) {
+	struct vma *r = v->right;
+
+	v->right = r->left;
+	r->left = v;
+	vma_update(v);
+	vma_update(r);
+	return r;
+}
+
+/* Restores the AVL balance at V after one of its subtrees
+   changed height by at most one, and returns the new subtree
+   root. */
+static struct vma *
+rebalance (struct vma *v) {
+	int balance;
+
+	vma_update(v);
+	balance = vma_height(v->left) - vma_height(v->right);
+	if (balance > 1) {
+		if (vma_height(v->left->left) < vma_height(v->left->right))
+			v->left = rotate_left(v->left);
+		return rotate_right(v);
+	}
+	if (balance < -1) {
+		if (vma_height(v->right->right) < vma_height(v->right->left))
+			v->right = rotate_right(v->right);
+		return rotate_left(v);
+	}
+	return v;
+}
+
+static struct vma *
+avl_insert (struct vma *node, struct vma *vma) {
+	if (node == NULL) {
+		vma->left = vma->right = NULL;
+		vma->height = 1;
+		return vma;
+	}
+	if (vma->start < node->start)
+		node->left = avl_insert(node->left, vma);
+	else
+		node->right = avl_insert(node->right, vma);
+	return rebalance(node);
+}
+
+static struct vma *
+remove_min (struct vma *node, struct vma **min) {
+	if (node->left == NULL) {
+		*min = node;
+		return node->right;
+	}
+	node->left = remove_min(node->left, min);
+	return rebalance(node);
+}
+
+static struct vma *
+avl_remove (struct vma *node, struct vma *vma) {
+	ASSERT(node != NULL);
+
+	if (vma->start < node->start)
+		node->left = avl_remove(node->left, vma);
+	else if (vma->start > node->start)
+		node->right = avl_remove(node->right, vma);
+	else {
+		struct vma *left = node->left, *right = node->right, *min;
+
+		ASSERT(node == vma);
+		if (right == NULL)
+			return left;
+		right = remove_min(right, &min);
+		min->left = left;
+		min->right = right;
+		return rebalance(min);
+	}
+	return rebalance(node);
+}
+
+static void
+avl_foreach (struct vma *node, void (*action) (struct vma *, void *), void *aux) {
+	if (node == NULL)
+		return;
+	avl_foreach(node->left, action, aux);
+	action(node, aux);
+	avl_foreach(node->right, action, aux);
+}
+
+/* Initializes TREE as empty. */
+void
+vma_tree_init (struct vma_tree *tree) {
+	tree->root = NULL;
+}
+
+/* Inserts VMA, which must not overlap any VMA in TREE. */
+void
+vma_insert (struct vma_tree *tree, struct vma *vma) {
+	ASSERT(!vma_overlaps(tree, vma->start, vma->end));
+	tree->root = avl_insert(tree->root, vma);
+}
+
+/* Removes VMA from TREE. */
+void
+vma_remove (struct vma_tree *tree, struct vma *vma) {
+	tree->root = avl_remove(tree->root, vma);
+}
+
+/* Returns the VMA in TREE that contains VA, or a null pointer. */
+struct vma *
+vma_find (struct vma_tree *tree, const void *va) {
+	struct vma *node = tree->root;
+
+	while (node != NULL) {
+		if (va < node->start)
+			node = node->left;
+		else if (va >= node->end)
+			node = node->right;
+		else
+			return node;
+	}
+	return NULL;
+}
+
+/* Returns true if some VMA in TREE overlaps [START, END). */
+bool
+vma_overlaps (struct vma_tree *tree, const void *start, const void *end) {
+	struct vma *node = tree->root;
+
+	while (node != NULL) {
+		if (end <= node->start)
+			node = node->left;
+		else if (start >= node->end)
+			node = node->right;
+		else
+			return true;
+	}
+	return false;
+}
+
+/* Calls ACTION on every VMA in TREE in address order.  ACTION
+   must not modify TREE. */
+void
+vma_foreach (struct vma_tree *tree, void (*action) (struct vma *, void *),
+		void *aux) {
+	avl_foreach(tree->root, action, aux);
+}
+
+#define PAGE_INDEX_FANOUT (1 << PAGE_INDEX_BITS)
+
+#if ((KERN_BASE - 1) >> PGBITS) >> (PAGE_INDEX_BITS * PAGE_INDEX_LEVELS) != 0
+#error "page index does not cover every user page number"
+#endif
+
+/* Returns the slot for page number PGNO in a node at LEVEL. */
+static size_t
+index_slot (uint64_t pgno, int level) {
+	return (pgno >> (PAGE_INDEX_BITS * (PAGE_INDEX_LEVELS - 1 - level)))
+		& (PAGE_INDEX_FANOUT - 1);
+}
+
+/* Returns the number of pages a slot in a node at LEVEL covers. */
+static uint64_t
+index_span (int level) {
+	return (uint64_t) 1 << (PAGE_INDEX_BITS * (PAGE_INDEX_LEVELS - 1 - level));
+}
+
+/* Returns true if page number PGNO fits in the index.  Anything
+   else would alias a lower page once index_slot() masks it. */
+static bool
+index_covers (uint64_t pgno) {
+	return pgno >> (PAGE_INDEX_BITS * PAGE_INDEX_LEVELS) == 0;
+}
+
+/* Initializes INDEX as empty. */
+void
+page_index_init (struct page_index *index) {
+	index->root = NULL;
+}
+
+/* Returns the page at VA in INDEX, or a null pointer. */
+struct page *
+page_index_lookup (struct page_index *index, const void *va) {
+	uint64_t pgno = pg_no(va);
+	void **node = index->root;
+
+	if (!index_covers(pgno))
+		return NULL;
+	for (int level = 0; level < PAGE_INDEX_LEVELS - 1 && node != NULL; level++)
+		node = node[index_slot(pgno, level)];
+	return node != NULL ? node[index_slot(pgno, PAGE_INDEX_LEVELS - 1)] : NULL;
+}
+
+/* Inserts PAGE into INDEX at PAGE->va, creating nodes on the way.
+   Returns false if out of memory or if VA lies outside the index. */
+bool
+page_index_insert (struct page_index *index, struct page *page) {
+	uint64_t pgno = pg_no(page->va);
+	void ***slot = &index->root;
+
+	if (!index_covers(pgno))
+		return false;
+	for (int level = 0; level < PAGE_INDEX_LEVELS; level++) {
+		if (*slot == NULL) {
+			*slot = calloc(PAGE_INDEX_FANOUT, sizeof (void *));
+			if (*slot == NULL)
+				return false;
+		}
+		slot = (void ***) &(*slot)[index_slot(pgno, level)];
+	}
+	*(struct page **) slot = page;
+	return true;
+}
+
+/* Returns true if no slot of NODE is in use. */
+static bool
+index_node_empty (void **node) {
+	for (size_t i = 0; i < PAGE_INDEX_FANOUT; i++)
+		if (node[i] != NULL)
+			return false;
+	return true;
+}
+
+/* Removes the page at VA from INDEX, freeing every node on the
+   way that is left with no children. */
+void
+page_index_remove (struct page_index *index, const void *va) {
+	uint64_t pgno = pg_no(va);
+	void **path[PAGE_INDEX_LEVELS];
+	void **node = index->root;
+	int level;
+
+	if (!index_covers(pgno))
+		return;
+	for (level = 0; level < PAGE_INDEX_LEVELS; level++) {
+		if (node == NULL)
+			return;
+		path[level] = node;
+		node = node[index_slot(pgno, level)];
+	}
+
+	for (level = PAGE_INDEX_LEVELS - 1; level >= 0; level--) {
+		path[level][index_slot(pgno, level)] = NULL;
+		if (!index_node_empty(path[level]))
+			return;
+		free(path[level]);
+	}
+	index->root = NULL;
+}
+
+/* Returns the lowest-numbered page in NODE, a node at LEVEL whose
+   first slot covers page number BASE, that lies within page
+   numbers [FIRST, LAST], or a null pointer if there is none. */
+static struct page *
+index_next (void **node, int level, uint64_t base, uint64_t first,
+		uint64_t last) {
+	uint64_t span = index_span(level);
+
+	for (size_t i = first > base ? (first - base) / span : 0;
+			i < PAGE_INDEX_FANOUT; i++) {
+		uint64_t lo = base + i * span;
+		struct page *page;
+
+		if (lo > last)
+			break;
+		if (node[i] == NULL)
+			continue;
+		if (level == PAGE_INDEX_LEVELS - 1)
+			return node[i];
+		page = index_next(node[i], level + 1, lo, first, last);
+		if (page != NULL)
+			return page;
+	}
+	return NULL;
+}
+
+/* Calls ACTION on every page in INDEX within [START, END) in
+   address order, skipping subtrees with no pages.  ACTION may
+   remove the page it is given, even if that frees the nodes
+   above it, since every step starts again from the root. */
+void
+page_index_foreach (struct page_index *index, const void *start,
+		const void *end, void (*action) (struct page *, void *), void *aux) {
+	uint64_t first, last;
+	struct page *page;
+
+	if (start >= end)
+		return;
+	first = pg_no(start);
+	last = pg_no(end - 1);
+	while (first <= last && index->root != NULL
+			&& (page = index_next(index->root, 0, 0, first, last)) != NULL) {
+		first = pg_no(page->va) + 1;
+		action(page, aux);
+	}
+}
+
+static void
+index_destroy (void **node, int level) {
+	if (level < PAGE_INDEX_LEVELS - 1)
+		for (size_t i = 0; i < PAGE_INDEX_FANOUT; i++)
+			if (node[i] != NULL)
+				index_destroy(node[i], level + 1);
+	free(node);
+}
+
+/* Frees INDEX's nodes, but not the pages in it. */
+void
+page_index_destroy (struct page_index *index) {
+	if (index->root != NULL)
+		index_destroy(index->root, 0);
+	index->root = NULL;
+}
@@ -0,0 +1,268 @@
+/* zswap.c: Compressed cache for evicted anonymous pages.
+ *
+ * Before an anonymous page goes to the swap disk it is compressed with a
+ * small LZ77 compressor and kept in a malloc()ed buffer from the kernel
+ * pool.  Pages whose entry does not fit in ZSWAP_MAX_LEN bytes go straight to
+ * the disk.  Once the cache grows past its budget the least recently
+ * stored entries are decompressed and written back to the swap disk.
+ * */
+
+#include "vm/zswap.h"
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "vm/vm.h"
+
+/* Compressed page. */
+struct zswap_entry {
+	struct page *page;          /* Page whose contents this holds. */
+	struct list_elem lru_elem;  /* Element in lru_list. */
+	size_t len;                 /* Compressed length in bytes. */
+	uint8_t data[];             /* Compressed bytes. */
+};
+
+/** #Compressed Swap 압축 형식. 제어 바이트 C가 0x80 미만이면 뒤의 C + 1 바이트가 그대로 오고,
+ *  0x80 이상이면 (C & 0x7f) + LZ_MIN_MATCH 바이트를 2바이트 offset 앞에서 복사한다. */
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH)
+#define LZ_MAX_LITERAL 0x80
+#define LZ_HASH_BITS 12
+#define LZ_EMPTY UINT16_MAX
+
+static struct lock zswap_lock;      /* 아래 모든 상태를 보호한다 */
+static struct list lru_list;        /* 오래 전에 넣은 entry가 앞에 온다 */
+static size_t zswap_bytes;          /* 캐시 entry들이 malloc()에서 받은 byte 수 */
+static size_t zswap_limit;          /* 캐시가 차지할 수 있는 최대 byte 수 */
+static uint16_t lz_table[1 << LZ_HASH_BITS]; /* 3바이트 해시 -> 마지막으로 나온 위치 */
+static uint8_t lz_buf[ZSWAP_MAX_LEN];
+static void *writeback_page;        /* write back할 때 압축을 풀어 둘 페이지 */
+
+static unsigned long long stored_cnt;      /* 캐시에 넣은 페이지 수 */
+static unsigned long long rejected_cnt;    /* 압축되지 않아 디스크로 보낸 페이지 수 */
+static unsigned long long loaded_cnt;      /* 캐시에서 읽어 온 페이지 수 */
+static unsigned long long writeback_cnt;   /* 캐시에서 밀려 디스크로 쓴 페이지 수 */
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max);
+static void lz_decompress (const uint8_t *src, size_t len, uint8_t *dst);
+static bool zswap_writeback (void);
+static void zswap_remove (struct zswap_entry *entry);
+
+/* Initializes the compressed cache.  It may use up to an eighth
+ * of the kernel pool. */
+void
+zswap_init (void) {
+	lock_init(&zswap_lock);
+	list_init(&lru_list);
+	zswap_limit = palloc_free_cnt(0) / 8 * PGSIZE;
+	writeback_page = palloc_get_page(PAL_ASSERT);
+}
+
+/* Compresses KVA, the contents of PAGE, into the cache.  Returns
+ * false if it does not compress well enough or there is no room
+ * even after writing old entries back, in which case PAGE has to
+ * go to the swap disk. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *entry;
+	size_t len;
+
+	lock_acquire(&zswap_lock);
+	/* entry 머리까지 합쳐 ZSWAP_MAX_LEN byte짜리 malloc() block 하나에 들어가야 한다 */
+	len = lz_compress(kva, lz_buf, ZSWAP_MAX_LEN - sizeof *entry);
+	if (len == 0) {
+		rejected_cnt++;
+		goto fail;
+	}
+
+	entry = malloc(sizeof *entry + len);
+	if (entry == NULL)
+		goto fail;
+
+	/* malloc()은 2의 거듭제곱으로 올려 잡으므로 실제로 받은 block 크기로 예산을 센다.
+	 * 예산을 넘으면 가장 오래된 entry부터 디스크로 밀어낸다 */
+	while (zswap_bytes + malloc_block_size(entry) > zswap_limit)
+		if (!zswap_writeback()) {
+			free(entry);
+			goto fail;
+		}
+
+	entry->page = page;
+	entry->len = len;
+	memcpy(entry->data, lz_buf, len);
+	list_push_back(&lru_list, &entry->lru_elem);
+	zswap_bytes += malloc_block_size(entry);
+	page->anon.zswap = entry;
+	stored_cnt++;
+	lock_release(&zswap_lock);
+	return true;
+
+fail:
+	lock_release(&zswap_lock);
+	return false;
+}
+
+/* If PAGE is in the cache, decompresses it into KVA, drops it
+ * from the cache and returns true.  Returns false otherwise. */
+bool
+zswap_load (struct page *page, void *kva) {
+	struct zswap_entry *entry;
+
+	lock_acquire(&zswap_lock);
+	entry = page->anon.zswap;
+	if (entry != NULL) {
+		lz_decompress(entry->data, entry->len, kva);
+		zswap_remove(entry);
+		loaded_cnt++;
+	}
+	lock_release(&zswap_lock);
+	return entry != NULL;
+}
+
+/* Like zswap_load(), but leaves PAGE in the cache. */
+bool
+zswap_copy (struct page *page, void *kva) {
+	struct zswap_entry *entry;
+
+	lock_acquire(&zswap_lock);
+	entry = page->anon.zswap;
+	if (entry != NULL)
+		lz_decompress(entry->data, entry->len, kva);
+	lock_release(&zswap_lock);
+	return entry != NULL;
+}
+
+/* Drops PAGE from the cache, if it is there. */
+void
+zswap_invalidate (struct page *page) {
+	lock_acquire(&zswap_lock);
+	if (page->anon.zswap != NULL)
+		zswap_remove(page->anon.zswap);
+	lock_release(&zswap_lock);
+}
+
+/* Prints compressed cache statistics. */
+void
+zswap_print_stats (void) {
+	printf("Zswap: %zu of %zu bytes used, %llu stored, %llu rejected, "
+			"%llu loaded, %llu written back\n",
+			zswap_bytes, zswap_limit, stored_cnt, rejected_cnt,
+			loaded_cnt, writeback_cnt);
+}
+
+/** #Compressed Swap 가장 오래된 entry의 압축을 풀어 swap disk에 쓰고 캐시에서 뺀다.
+ *  disk에 빈 slot이 없으면 false. zswap_lock을 잡은 채로 디스크에 쓰므로,
+ *  그 사이 이 페이지에 fault가 나면 zswap_load()에서 기다렸다가 disk에서 읽는다. */
+static bool
+zswap_writeback (void) {
+	struct zswap_entry *entry;
+
+	ASSERT(lock_held_by_current_thread(&zswap_lock));
+
+	if (list_empty(&lru_list))
+		return false;
+	entry = list_entry(list_front(&lru_list), struct zswap_entry, lru_elem);
+	lz_decompress(entry->data, entry->len, writeback_page);
+	if (!anon_swap_write(entry->page, writeback_page))
+		return false;
+	zswap_remove(entry);
+	writeback_cnt++;
+	return true;
+}
+
+static void
+zswap_remove (struct zswap_entry *entry) {
+	list_remove(&entry->lru_elem);
+	zswap_bytes -= malloc_block_size(entry);
+	entry->page->anon.zswap = NULL;
+	free(entry);
+}
+
+/* Returns a hash of the 3 bytes at P. */
+static inline unsigned
+lz_hash (const uint8_t *p) {
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends the CNT literal bytes at SRC to DST + *OP.  Returns
+ * false if they do not fit in DST_MAX bytes. */
+static bool
+lz_emit_literals (const uint8_t *src, size_t cnt, uint8_t *dst, size_t *op,
+		size_t dst_max) {
+	while (cnt > 0) {
+		size_t run = cnt < LZ_MAX_LITERAL ? cnt : LZ_MAX_LITERAL;
+
+		if (*op + 1 + run > dst_max)
+			return false;
+		dst[(*op)++] = run - 1;
+		memcpy(dst + *op, src, run);
+		*op += run;
+		src += run;
+		cnt -= run;
+	}
+	return true;
+}
+
+/* Compresses the PGSIZE bytes at SRC into DST and returns the
+ * compressed length, or 0 if it would exceed DST_MAX bytes. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_max) {
+	size_t ip = 0, op = 0, lit = 0;
+
+	memset(lz_table, 0xff, sizeof lz_table);
+	while (ip + LZ_MIN_MATCH <= PGSIZE) {
+		unsigned h = lz_hash(src + ip);
+		size_t cand = lz_table[h];
+		size_t len;
+
+		lz_table[h] = ip;
+		if (cand == LZ_EMPTY || memcmp(src + cand, src + ip, LZ_MIN_MATCH)) {
+			ip++;
+			continue;
+		}
+
+		len = LZ_MIN_MATCH;
+		while (ip + len < PGSIZE && len < LZ_MAX_MATCH && src[cand + len] == src[ip + len])
+			len++;
+
+		if (!lz_emit_literals(src + lit, ip - lit, dst, &op, dst_max) || op + 3 > dst_max)
+			return 0;
+		dst[op++] = 0x80 | (len - LZ_MIN_MATCH);
+		dst[op++] = (ip - cand) & 0xff;
+		dst[op++] = (ip - cand) >> 8;
+		ip += len;
+		lit = ip;
+	}
+	if (!lz_emit_literals(src + lit, PGSIZE - lit, dst, &op, dst_max))
+		return 0;
+	return op;
+}
+
+/* Decompresses the LEN bytes at SRC into the page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t len, uint8_t *dst) {
+	size_t ip = 0, op = 0;
+
+	while (ip < len) {
+		uint8_t ctrl = src[ip++];
+
+		if (ctrl < 0x80) {
+			memcpy(dst + op, src + ip, ctrl + 1);
+			ip += ctrl + 1;
+			op += ctrl + 1;
+		} else {
+			size_t cnt = (ctrl & 0x7f) + LZ_MIN_MATCH;
+			size_t offset = src[ip] | (src[ip + 1] << 8);
+
+			ip += 2;
+			/* 겹칠 수 있으므로 한 바이트씩 복사한다 */
+			for (; cnt > 0; cnt--, op++)
+				dst[op] = dst[op - offset];
+		}
+	}
+	ASSERT(op == PGSIZE);
+}